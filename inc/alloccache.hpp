@@ -10,8 +10,9 @@
  *
  *  Classes, methods and structures: \details
  *
- *  External: atomic_inc_return, atomic_dec_return, allocator, ialloc_cache iqalloc_cache
- *  Internal: alloc_cache
+ *  External: atomic_inc_return, atomic_dec_return, allocator, ialloc_cache iqalloc_cache magalloc_cache gqalloc_cache
+ *            numa_alloc_cache
+ *  Internal: alloc_cache, alloc_cache_array
  *
  *  TODO:		\todo replace algorithm with interlocked queue with only one interlocked operation
  *
@@ -22,8 +23,12 @@
 
 #include "impl/ialloccache.hpp"
 #include "impl/iqalloccache.hpp"
+#include "impl/magalloccache.hpp"
+#include "impl/gqalloccache.hpp"
+#include "impl/numaalloccache.hpp"
 
 #define TS_ALLOC_CACHE_BUFFER_SIZE 0x400
+#define TS_ALLOC_CACHE_TRY_COUNTER 3 ///< number of size classes tried by alloc_cache_array
 
 namespace tstl {
 
@@ -70,14 +75,37 @@ template <class Tvalue = char, class Tallocator = allocator, class Taux_allocato
           class Talloc_cache = iqalloc_cache  <Tvalue, Tallocator, Taux_allocator> >
 
 /// allocating cache array
+/** Caches of size classes share one contiguous storage carved into arenas. Size class is found
+  * by shift (division when increment isn't power of 2), owner of buffer is found by shift of
+  * buffer offset in arenas map and compare with arena end. */
 class alloc_cache_array
 {
-  Talloc_cache* array;
-  long    use_counter;  ///< using counter
+  typedef struct class_stat
+  {
+    long hits;      ///< buffers given by cache of class
+    long misses;    ///< cache of class was exhausted, next class was tried
+    long fallbacks; ///< buffers asked from global mempool
+  } cs, *pcs;
+
+  Talloc_cache** array;
+  cs*     stats;
+  size_t* arena_end;      ///< end offset of class arena in storage
+  long*   arena_map;      ///< class of arena at begin of every map chunk
+  long    map_shift;      ///< map chunk is (1 << map_shift) symbols <Tvalue>
+
+  Tvalue* storage;        ///< storage of all classes
+  size_t  storage_size;
+
+  long    use_counter;    ///< using counter
   const long array_size;
   const bool dont_use_global_mempool; /// allocating behaviour
 
-  Tallocator allocator;
+  const size_t begin_buffer_size;
+  const size_t buffer_size_increment;
+  long    increment_shift; ///< -1 if increment isn't power of 2
+
+      Tallocator     allocator;
+  Taux_allocator aux_allocator;
 
   Tvalue* get_from_global_mempool (const size_t size)
   {
@@ -98,6 +126,36 @@ class alloc_cache_array
     return true;
   }
 
+  /// Size class of buffer, array_size if size is too big for all classes
+  long size_class (const size_t size) const
+  {
+    if (size <= begin_buffer_size)
+      return 0;
+
+    if (!buffer_size_increment)
+      return array_size;
+
+    size_t over = size - begin_buffer_size + buffer_size_increment - 1;
+    size_t cls  = increment_shift >= 0 ? over >> increment_shift : over / buffer_size_increment;
+
+    return cls < (size_t) array_size ? (long) cls : array_size;
+  }
+
+  /// Class of cache which owns buffer, -1 if buffer isn't from storage
+  long owner_class (Tvalue* buffer) const
+  {
+    if (!storage || buffer < storage || buffer >= storage + storage_size)
+      return -1;
+
+    size_t offset = buffer - storage;
+    long cls = arena_map [offset >> map_shift];
+
+    while (offset >= arena_end [cls]) ///< chunk begins in previous arena, empty arenas are skipped
+      cls++;
+
+    return cls;
+  }
+
 public:
   void* operator new (size_t size)
   { Tallocator allocator; return allocator.allocate (size); }
@@ -115,54 +173,45 @@ public:
 
   ~alloc_cache_array ()
   {
-    if (!array || !array_size) { brk (); return; }
-
-    for (long cnt = 0; cnt < array_size; cnt++)
+    if (array)
     {
-      if (!array [cnt]) { brk (); continue; }
-      delete (array [cnt]), array [cnt] = 0;
-    }
-  }
+      for (long cnt = 0; cnt < array_size; cnt++)
+        if (array [cnt]) delete (array [cnt]), array [cnt] = 0;
 
-  bool is_empty () const
-  {
-    bool is_used = false;
-
-    for (long cnt = 0; cnt < array_size; cnt++)
-    {
-      if (!array [cnt]) continue;
-      is_used |= !array [cnt]->is_empty ();
+      aux_allocator.deallocate (array), array = 0;
     }
 
-    return !is_used;
+    if (stats)     aux_allocator.deallocate (stats),     stats = 0;
+    if (arena_end) aux_allocator.deallocate (arena_end), arena_end = 0;
+    if (arena_map) aux_allocator.deallocate (arena_map), arena_map = 0;
+    if (storage)       allocator.deallocate (storage),   storage = 0;
   }
 
+  bool is_empty () const
+  { return 0 == use_counter; }
+
   /// Get statistic about cache using
   long get_stat (long array_index = -1) const;
 
-  bool is_address_from_cache (Tvalue* buffer) const
+  /// Get statistic about size class
+  /** \param[in] array_index is size class, too big buffers are counted as fallbacks of last class */
+  bool get_class_stat (long array_index, long* hits, long* misses, long* fallbacks) const
   {
-    for (long cnt = 0; cnt < array_size; cnt++)
-    {
-      if (!array [cnt]) continue;
-      if (array [cnt]->is_address_from_cache (buffer) )
-        return true;
-    }
+    if (!stats || array_index < 0 || array_index >= array_size)
+    { brk (); return false; }
 
-    return false;
+    if (hits)      *hits      = stats [array_index].hits;
+    if (misses)    *misses    = stats [array_index].misses;
+    if (fallbacks) *fallbacks = stats [array_index].fallbacks;
+
+    return true;
   }
 
-  bool is_size_enough (const size_t size) const
-  {
-    for (long cnt = 0; cnt < array_size; cnt++)
-    {
-      if (!array [cnt]) continue;
-      if (array [cnt]->is_size_enough (size) )
-        return true;
-    }
+  bool is_address_from_cache (Tvalue* buffer) const
+  { return owner_class (buffer) >= 0; }
 
-    return fal se;
-  }
+  bool is_size_enough (const size_t size) const
+  { return size_class (size) < array_size; }
 
   /** \param size is amount of symbols <Tvalue> in buffer */
   Tvalue* get (const size_t size);
@@ -173,30 +222,86 @@ public:
 template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache>
 alloc_cache_array <Tvalue,    Tallocator,       Taux_allocator,       Talloc_cache>
 
-:: alloc_cache_array (const size_t begin_buffer_size = TS_ALLOC_CACHE_BUFFER_SIZE,
-                      const long begin_elem_number = TS_MAX_SEARCH_DEPTH,
-                      const long search_depth      = TS_MAX_SEARCH_DEPTH,
-                      const bool in_dont_use_global_mempool = false,
-                      const long in_array_size = 6,
-                      const long buffer_size_increment = TS_ALLOC_CACHE_BUFFER_SIZE,
-                      const long elem_number_power_decrement = 1)
-
-                    : array (0), use_counter (0), array_size (in_array_size),
-                      dont_use_global_mempool (in_dont_use_global_mempool)
+:: alloc_cache_array (const size_t in_begin_buffer_size,
+                      const long begin_elem_number,
+                      const long search_depth,
+                      const bool in_dont_use_global_mempool,
+                      const long in_array_size,
+                      const long in_buffer_size_increment,
+                      const long elem_number_power_decrement)
+
+                    : array (0), stats (0), arena_end (0), arena_map (0), map_shift (0),
+                      storage (0), storage_size (0), use_counter (0), array_size (in_array_size),
+                      dont_use_global_mempool (in_dont_use_global_mempool),
+                      begin_buffer_size (in_begin_buffer_size),
+                      buffer_size_increment (in_buffer_size_increment), increment_shift (-1)
 {
-  array = allocator.allocate (array_size * sizeof (*array) );
-  if (!array) { brk (); return; }
+  if (array_size <= 0 || !begin_buffer_size) { brk (); return; }
+
+  if (buffer_size_increment && !(buffer_size_increment & (buffer_size_increment - 1) ) )
+    for (increment_shift = 0; ( (size_t) 1 << increment_shift) < buffer_size_increment; increment_shift++) {}
+
+  array     = (Talloc_cache**) aux_allocator.allocate (array_size * sizeof (*array) );
+  stats     = (pcs)            aux_allocator.allocate (array_size * sizeof (*stats) );
+  arena_end = (size_t*)        aux_allocator.allocate (array_size * sizeof (*arena_end) );
+
+  if (!array || !stats || !arena_end) { brk (); return; }
 
   memset (array, 0, array_size * sizeof (*array) );
+  memset (stats, 0, array_size * sizeof (*stats) );
 
+  /// arenas layout, the smallest arena gives map chunk size
   size_t buffer_size = begin_buffer_size;
   long   max_elem    = begin_elem_number;
+  size_t min_arena   = 0;
+  long   cnt = 0;
+
+  for (; cnt < array_size; cnt++,
+       buffer_size += buffer_size_increment,
+       max_elem   >>= elem_number_power_decrement)
+  {
+    size_t arena = buffer_size * (max_elem > 0 ? max_elem : 0);
+
+    storage_size += arena;
+    arena_end [cnt] = storage_size;
+
+    if (arena && (!min_arena || arena < min_arena))
+      min_arena = arena;
+  }
+
+  if (!storage_size) { brk (); return; }
+
+  while ( ( (size_t) 2 << map_shift) <= min_arena)
+    map_shift++;
+
+  size_t map_size = (storage_size >> map_shift) + 1;
+
+  storage   = (Tvalue*) allocator.allocate (storage_size * sizeof (*storage) );
+  arena_map = (long*) aux_allocator.allocate (map_size * sizeof (*arena_map) );
+
+  if (!storage || !arena_map) { brk (); return; }
+
+  for (size_t chunk = 0, cls = 0; chunk < map_size; chunk++)
+  {
+    while (cls < (size_t) array_size - 1 && (chunk << map_shift) >= arena_end [cls])
+      cls++;
 
-  for (long cnt = 0; cnt < array_size; cnt++,
+    arena_map [chunk] = (long) cls;
+  }
+
+  /// caches adopt own arenas of storage
+  buffer_size = begin_buffer_size;
+  max_elem    = begin_elem_number;
+
+  for (cnt = 0; cnt < array_size; cnt++,
        buffer_size += buffer_size_increment,
        max_elem   >>= elem_number_power_decrement)
   {
-    array [cnt] = new Talloc_cache (buffer_size, max_elem, search_depth, true);
+    if (max_elem <= 0) continue;
+
+    Tvalue* arena = storage + arena_end [cnt] - buffer_size * max_elem;
+
+    array [cnt] = new Talloc_cache (buffer_size, max_elem, search_depth, true, arena);
     if (!array [cnt]) { brk (); }
   }
 }
@@ -205,21 +310,13 @@ alloc_cache_array <Tvalue,    Tallocator,       Taux_allocator,       Talloc_cac
 template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache>
 long alloc_cache_array <Tvalue, Tallocator,     Taux_allocator,       Talloc_cache>
 
-:: get_stat (long array_index = -1) const
+:: get_stat (long array_index) const
 {
   if (-1 != array_index
    && array_index < array_size)
-   return array [array_index]->get_stat ();
+   return array [array_index] ? array [array_index]->get_stat () : 0;
 
-  long used = 0;
-
-  for (long cnt = 0; cnt < array_size; cnt++)
-  {
-    if (!array [cnt]) continue;
-    used += array [cnt]->get_stat ();
-  }
-
-  return used;
+  return use_counter;
 }
 
 template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache>
@@ -227,30 +324,36 @@ Tvalue* alloc_cache_array <Tvalue, Tallocator,  Taux_allocator,       Talloc_cac
 
 :: get (const size_t size)
 {
-  long cnt = 0;
+  if (!size)
+  { brk (); return 0; }
 
-  for (; cnt < array_size; cnt++)
-  {
-    if (!array [cnt]) continue;
-    if (array [cnt]->is_size_enough (size) )
-      break;
-  }
+  if (!array || !stats)
+  { brk (); return get_from_global_mempool (size); }
 
-  if (cnt >= array_size)
-    return get_from_global_mempool (size);
+  long cls = size_class (size);
 
-  for (try_count = 0; cnt < array_size && try_count < 3; cnt++, try_count++)
+  if (cls >= array_size)
   {
-    if (!array [cnt]) continue;
+    atomic_inc_relaxed (& stats [array_size - 1].fallbacks);
+    return get_from_global_mempool (size);
+  }
 
-    Tvalue* pvalue = array [cnt]->get (size);
+  for (long try_count = 0, cnt = cls; cnt < array_size && try_count < TS_ALLOC_CACHE_TRY_COUNTER; cnt++, try_count++)
+  {
+    Tvalue* pvalue = array [cnt] ? array [cnt]->get (size) : 0;
 
-    if (!pvalue) continue;
+    if (!pvalue)
+    {
+      atomic_inc_relaxed (& stats [cnt].misses);
+      continue;
+    }
 
+    atomic_inc_relaxed (& stats [cnt].hits);
     atomic_inc (& use_counter);
     return pvalue;
   }
 
+  atomic_inc_relaxed (& stats [cls].fallbacks);
   return get_from_global_mempool (size);
 }
 
@@ -259,16 +362,11 @@ bool alloc_cache_array <Tvalue, Tallocator,     Taux_allocator,       Talloc_cac
 
 :: revert (Tvalue* buffer)
 {
-  long cnt = 0;
+  if (!buffer) { brk (); return false; }
 
-  for (; cnt < array_size; cnt++)
-  {
-    if (!array [cnt]) continue;
-    if (array [cnt]->is_address_from_cache (buffer) )
-      break;
-  }
+  long cls = owner_class (buffer);
 
-  if (cnt >= array_size)
+  if (cls < 0 || !array [cls])
   {
     if (dont_use_global_mempool)
     { brk (); /* it's alien pointer */ }
@@ -277,7 +375,7 @@ bool alloc_cache_array <Tvalue, Tallocator,     Taux_allocator,       Talloc_cac
     return false;
   }
 
-  bool rc = array [cnt]->revert (buffer);
+  bool rc = array [cls]->revert (buffer);
 
   if (rc) atomic_dec (& use_counter);
 
@@ -0,0 +1,251 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file bprequeue.hpp
+ *
+ *  Abstract:		\brief Bitmap priority queue, array of queues with bounded range of prioritets.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: iqueue, eventcount, atomic_or, atomic_and, bit_scan_reverse, process_barrier
+ *  Internal: bprequeue
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __BPREQUEUE_HPP__
+#define __BPREQUEUE_HPP__
+
+#include "tsqueue.hpp"
+
+#define TS_BPREQUEUE_LEVELS 256
+
+namespace tstl {
+
+/// Bitmap priority queue
+/** Every prioritet from 0 to Tlevels - 1 has own queue in flat array. Bit of level is set
+  * when its queue isn't empty, bit of group is set when any level of group isn't empty, so
+  * get_top finds highest prioritet by two bit scans. Put sets bits only if they aren't set
+  * yet, reader clears bit of empty queue and checks queue again, so put between them isn't
+  * lost. Reader pays for this store-load pair by process barrier, so put of marked level
+  * costs loads of bits only. Default iqueue has one reader, use cqueue or rqueue as Tqueue
+  * for many readers. */
+template <class Tvalue, class Tallocator = allocator,
+          class Tqueue = iqueue <Tvalue, melocker<>, Tallocator>, long Tlevels = TS_BPREQUEUE_LEVELS>
+
+class bprequeue
+{
+  enum { word_bits = sizeof (long) * 8,
+         groups_number = (Tlevels + word_bits - 1) / word_bits };
+
+  typedef char levels_check [Tlevels <= word_bits * word_bits ? 1 : -1];
+
+  volatile long summary;                ///< bit per group which has not empty levels
+  char summary_pad [TS_CACHE_LINE_SIZE - sizeof (long)];
+
+  volatile long groups [groups_number]; ///< bit per level which queue isn't empty
+
+  Tqueue* queues [Tlevels];
+
+  eventcount not_empty; ///< readers wait on it
+  eventcount not_full;  ///< writers wait on it if queue of prioritet is full
+
+  /// Set bits of level and its group
+  void mark (const long level)
+  {
+    long group = level / word_bits, bit = (long) (1UL << (level % word_bits) );
+
+    atomic_fence_asymmetric (); ///< value is in queue before bits are read, unmark pays by process barrier
+
+    if (!(atomic_load_relaxed (& groups [group]) & bit) )
+      atomic_or ( (long*) & groups [group], bit);
+
+    if (!(atomic_load_relaxed (& summary) & (long) (1UL << group) ) )
+      atomic_or ( (long*) & summary, (long) (1UL << group) );
+  }
+
+  /// Clear bit of empty group, set it again if level was marked meanwhile
+  void unmark_group (const long group)
+  {
+    atomic_and ( (long*) & summary, ~(long) (1UL << group) );
+
+    if (!process_barrier () ) ///< mark of other thread is visible now, or it sees cleared bit
+      atomic_fence ();
+
+    if (atomic_load_acquire (& groups [group]) )
+      atomic_or ( (long*) & summary, (long) (1UL << group) );
+  }
+
+  /// Clear bit of empty level, set it again if value was put meanwhile
+  void unmark (const long level)
+  {
+    long group = level / word_bits, bit = (long) (1UL << (level % word_bits) );
+
+    long prev = atomic_and ( (long*) & groups [group], ~bit);
+
+    if (!process_barrier () ) ///< put of other thread is visible now, or it sees cleared bit
+      atomic_fence ();
+
+    if (!queues [level]->is_empty () )
+      mark (level);
+    else
+    if (!(prev & ~bit) )
+      unmark_group (group);
+  }
+
+public:
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  bprequeue (const long alloc_cache_elem = 16) : summary (0)
+  {
+    memset ( (void*) groups, 0, sizeof (groups) );
+    memset (queues, 0, sizeof (queues) );
+
+    for (long i = 0; i < Tlevels; i++)
+      if (!init_queue (queues [i], alloc_cache_elem) ) { brk (); return; }
+  }
+
+  ~bprequeue ()
+  {
+    for (long i = 0; i < Tlevels; i++)
+      if (queues [i]) { delete queues [i], queues [i] = 0; }
+  }
+
+  /// Is not thread safe method, bits of emptied levels are cleared by get_top lazily
+  bool is_empty () const
+  { return 0 == summary || 0 == get_stat (); }
+
+  /// Get statistic about queue using
+  long get_stat () const
+  {
+    long used = 0;
+
+    for (long i = 0; i < Tlevels; i++)
+      if (queues [i]) used += queues [i]->get_stat ();
+
+    return used;
+  }
+
+  /// Stores Tvalues.
+  /** \param[in] buffer is pointer to Tvalues
+    * \param[in] prioritet is number from 0 to Tlevels - 1, bigger is more urgent
+    * \return true if Tvalues put into queue. */
+  bool put (Tvalue* buffer, long prioritet = 0)
+  {
+    if (!buffer || prioritet < 0 || prioritet >= Tlevels || !queues [prioritet])
+    { brk (); return false; }
+
+    if (!queues [prioritet]->put (buffer) )
+      return false; ///< queue of prioritet is full
+
+    mark (prioritet);
+
+    not_empty.notify_all ();
+    return true;
+  }
+
+  /// Retrives Tvalues of prioritet.
+  /** \param[in] buffer is pointer to Tvalues
+    * \param[in] prioritet is number from 0 to Tlevels - 1
+    * \return true if Tvalues get from queue. */
+  bool get (Tvalue* buffer, long prioritet = 0)
+  {
+    if (!buffer || prioritet < 0 || prioritet >= Tlevels || !queues [prioritet])
+    { brk (); return false; }
+
+    if (!queues [prioritet]->get (buffer) )
+      return false; ///< bit is cleared by get_top
+
+    not_full.notify_all ();
+    return true;
+  }
+
+  /// Retrives Tvalues of highest prioritet.
+  /** \param[in] buffer is pointer to Tvalues
+    * \param[out] prioritet is prioritet of Tvalues if it isn't 0
+    * \return true if Tvalues get from queue. */
+  bool get_top (Tvalue* buffer, long* prioritet = 0);
+
+  /// Stores Tvalues, waits while queue of prioritet is full.
+  /** \param[in] timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if queue is closed. */
+  bool put_wait (Tvalue* buffer, long prioritet = 0, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    bool rc = false;
+
+    if (not_full.is_closed () )
+      return false;
+
+    ts_event_wait (not_full, put (buffer, prioritet), timeout, rc);
+    return rc;
+  }
+
+  /// Retrives Tvalues of highest prioritet, waits while queue is empty.
+  /** \param[in] timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if queue is closed and empty. */
+  bool get_top_wait (Tvalue* buffer, long* prioritet = 0, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    bool rc = false;
+    ts_event_wait (not_empty, get_top (buffer, prioritet), timeout, rc);
+    return rc;
+  }
+
+  /// Wake all waiters for shutdown, next put_wait fails at once
+  void close ()
+  {
+    not_full.close ();
+    not_empty.close ();
+  }
+};
+
+/// Retrives Tvalues of highest prioritet.
+/** \param[in] buffer is pointer to Tvalues
+  * \param[out] prioritet is prioritet of Tvalues if it isn't 0
+  * \return true if Tvalues get from queue. */
+template <class Tvalue, class Tallocator, class Tqueue, long Tlevels>
+bool bprequeue <Tvalue,       Tallocator,       Tqueue,      Tlevels>
+
+:: get_top (Tvalue* buffer, long* prioritet)
+{
+  if (!buffer) { brk (); return false; }
+
+  for (;;)
+  {
+    unsigned long groups_bits = (unsigned long) atomic_load_acquire (& summary);
+
+    if (!groups_bits)
+      return false;
+
+    long group = bit_scan_reverse (groups_bits);
+
+    unsigned long levels_bits = (unsigned long) atomic_load_acquire (& groups [group]);
+
+    if (!levels_bits)
+    { unmark_group (group); continue; }
+
+    long level = group * word_bits + bit_scan_reverse (levels_bits);
+
+    if (queues [level]->get (buffer) )
+    {
+      if (prioritet)
+        *prioritet = level;
+
+      not_full.notify_all ();
+      return true;
+    }
+
+    unmark (level);
+  }
+}
+
+}; /* end of tstl namespace */
+
+#endif /* __BPREQUEUE_HPP__ */
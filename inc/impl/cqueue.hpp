@@ -54,7 +54,7 @@ public:
   {
     INIT_LIST_HEAD (& lh);
 
-    palloc_cache = new qeac (sizeof (qe), alloc_cache_elem);
+    palloc_cache = new Talloc_cache (sizeof (qe), alloc_cache_elem);
     if (!palloc_cache) { brk (); }
   }
 
@@ -83,6 +83,16 @@ public:
   /** \param[in] buffer is pointer to Tvalues
     * \return true if Tvalues get from pipe. */
   bool get (Tvalue* buffer);
+
+  /// Stores batch of Tvalues by one splice under locker.
+  /** \param[in] buffer is array of counter Tvalues
+    * \return number of Tvalues put into queue, it's less than counter if memory is over. */
+  long put_bulk (const Tvalue* buffer, const long counter);
+
+  /// Retrives up to counter Tvalues by one cut under locker.
+  /** \param[in] buffer is array of counter Tvalues
+    * \return number of Tvalues get from queue. */
+  long get_bulk (Tvalue* buffer, const long counter);
 };
 
 /// Stores Tvalues.
@@ -154,6 +164,104 @@ bool cqueue    <Tvalue,       Tlocker,       Tallocator,       Talloc_cache>
   return true;
 }
 
+/// Stores batch of Tvalues by one splice under locker.
+/** \param[in] buffer is array of counter Tvalues
+  * \return number of Tvalues put into queue, it's less than counter if memory is over. */
+template <class Tvalue, class Tlocker, class Tallocator, class Talloc_cache>
+long cqueue    <Tvalue,       Tlocker,       Tallocator,       Talloc_cache>
+
+:: put_bulk (const Tvalue* buffer, const long counter)
+{
+  if (!buffer || counter <= 0) { brk (); return 0; }
+
+  list_head chain;
+  INIT_LIST_HEAD (& chain);
+
+  long i = 0;
+
+  tstl :: allocator a;
+
+  for (; i < counter; i++)
+  {
+    /// get piece of memory
+    pqe pe = palloc_cache ? (pqe) palloc_cache->get  (sizeof (*pe) )
+                          : (pqe) allocator.allocate (sizeof (*pe) );
+    if (!pe)
+    { brk (); break; }
+
+    /// put value to temporary buffer
+    :: new ( (void*) & pe->value, a) Tvalue (buffer [i]);
+
+    list_add_tail ( (plh) pe, & chain);
+  }
+
+  if (!i)
+    return 0;
+
+  atomic_add_return (& use_counter, i);
+
+  /// add chain to list tail
+  queue_locker.lock ();
+
+  list_splice (& chain, lh.prev);
+
+  queue_locker.unlock ();
+
+  return i;
+}
+
+/// Retrives up to counter Tvalues by one cut under locker.
+/** \param[in] buffer is array of counter Tvalues
+  * \return number of Tvalues get from queue. */
+template <class Tvalue, class Tlocker, class Tallocator, class Talloc_cache>
+long cqueue    <Tvalue,       Tlocker,       Tallocator,       Talloc_cache>
+
+:: get_bulk (Tvalue* buffer, const long counter)
+{
+  if (!buffer || counter <= 0) { brk (); return 0; }
+
+  /// cut up to counter elements from list head
+  queue_locker.lock ();
+
+  plh first = lh.next, last = & lh;
+  long i = 0;
+
+  for (; i < counter && last->next != & lh; i++)
+    last = last->next;
+
+  if (i)
+  {
+    lh.next = last->next;
+    last->next->prev = & lh;
+  }
+
+  queue_locker.unlock ();
+
+  if (!i)
+    return 0;
+
+  atomic_add_return (& use_counter, -i);
+
+  tstl :: allocator a;
+
+  for (long j = 0; j < i; j++)
+  {
+    pqe pe = (pqe) first;
+    first = first->next;
+
+    /// copy value from temporary buffer
+    :: new ( (void*) & buffer [j], a) Tvalue (pe->value);
+
+    /// free temporary buffer
+    if (palloc_cache)
+      palloc_cache->revert ( (char*) pe), pe = 0;
+    else
+      allocator.deallocate ( (char*) pe), pe = 0;
+  }
+
+  return i;
+}
+
 }; /* end of tstl namespace */
 
 #endif /* __CQUEUE_HPP__ */
@@ -0,0 +1,534 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file dqueue.hpp
+ *
+ *  Abstract:		\brief Delay queue, values are got when their due time has passed.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: alloc_cache, melocker (relocker), allocator, eventcount, monotonic_time
+ *  Internal: dqueue, delay_handle
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __DQUEUE_HPP__
+#define __DQUEUE_HPP__
+
+#include "alloccache.hpp"
+#include "impl/tslist.hpp"
+#include "impl/tsevent.hpp"
+
+#define TS_DQUEUE_LEVELS    4   ///< levels of timing wheel, they cover 2^32 milliseconds
+#define TS_DQUEUE_SLOT_BITS 8   ///< 256 slots per level
+
+namespace tstl {
+
+/// Handle of delayed value, it's given by put and taken by cancel
+typedef struct delay_handle
+{
+  void* node;
+  unsigned long sequence; ///< node could be reused by other put, sequence tells it
+} dh, *pdh;
+
+/// Delay queue
+/** Hierarchical timing wheel with millisecond tick. Level 0 slot keeps values due at one tick,
+  * slot of level n keeps values due in 256^n ticks, they are cascaded to lower levels when
+  * wheel comes to slot, so put and cancel are O(1). Values which are due are moved to ready
+  * list in order of ticks, get takes them from it. Nodes are taken from allocating cache
+  * with fixed capacity, so there isn't heap allocation per value and cancel of stale handle
+  * reads memory of cache only. Bitmap of not empty slots per level tells exact tick of next
+  * level 0 slot or cascade of higher level slot, so waiter doesn't wake at every round end. */
+template <class Tvalue, class Tallocator = allocator, class Tlocker = melocker<>,
+          class Talloc_cache = iqalloc_cache <char, Tallocator, Tallocator> >
+
+class dqueue
+{
+  enum { slots_number = 1 << TS_DQUEUE_SLOT_BITS,
+         slot_mask    = slots_number - 1,
+         word_bits    = sizeof (long) * 8,
+         words_number = slots_number / word_bits };
+
+  enum { dead_node = 0, live_node = 1 };
+
+  typedef struct delay_node
+  {
+    list_head lh;           ///< slot or ready list
+    ulonglong due;          ///< milliseconds of monotonic_time
+    unsigned long sequence;
+    long status;
+    Tvalue value;
+  } dn, *pdn;
+
+  list_head wheel [TS_DQUEUE_LEVELS][slots_number];
+  unsigned long level_bits [TS_DQUEUE_LEVELS][words_number]; ///< bit per not empty slot of every level
+
+  list_head ready;         ///< due values in order of ticks
+  ulonglong current;       ///< next tick to process, ticks before it are processed
+  unsigned long sequence;
+  long use_counter;
+
+  Tlocker wheel_locker;
+
+  Talloc_cache* palloc_cache;
+
+  eventcount not_empty; ///< readers wait on it
+
+  /// Put node into slot by its due time, locker is held
+  void insert (pdn pn);
+
+  /// Move nodes of slot of level to lower levels, higher level is cascaded before
+  void cascade (const long level);
+
+  /// Process ticks till now, due nodes are moved to ready list
+  void advance (const ulonglong now);
+
+  void mark_slot (const long level, const long slot)
+  { level_bits [level][slot / word_bits] |= 1UL << (slot % word_bits); }
+
+  void unmark_slot (const long level, const long slot)
+  { level_bits [level][slot / word_bits] &= ~(1UL << (slot % word_bits) ); }
+
+  /// First not empty slot of level from index, -1 if there isn't it
+  long next_slot (const long level, const long index) const;
+
+  /// Next tick which should be processed, level 0 slot or cascade of higher level slot, ~0 if wheel is empty
+  ulonglong next_tick () const;
+
+  /// Milliseconds till next tick which should be processed, TS_INFINITE_TIMEOUT if wheel is empty
+  long next_due (const ulonglong now) const;
+
+  /// Take due node from ready list
+  /** \param[out] left is milliseconds till next due value if there isn't due one */
+  bool pop (Tvalue* buffer, long* left);
+
+  void free_node (pdn pn)
+  {
+    if (palloc_cache)
+      palloc_cache->revert ( (char*) pn), pn = 0;
+  }
+
+public:
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  /** \param capacity - max number of pending values, nodes are allocated once */
+  dqueue (const long capacity = 0x10000) : current (monotonic_time () ), sequence (0), use_counter (0)
+  {
+    for (long level = 0; level < TS_DQUEUE_LEVELS; level++)
+      for (long slot = 0; slot < slots_number; slot++)
+        INIT_LIST_HEAD (& wheel [level][slot]);
+
+    memset (level_bits, 0, sizeof (level_bits) );
+
+    INIT_LIST_HEAD (& ready);
+
+    /// one block of cache queue is its dummy
+    palloc_cache = new Talloc_cache (sizeof (dn), capacity + 1, TS_MAX_TRY_COUNTER, true);
+    if (!palloc_cache) { brk (); }
+  }
+
+  ~dqueue ();
+
+  /// Is not thread safe method, values which aren't due yet are counted too
+  bool is_empty () const
+  { return 0 == use_counter; }
+
+  /// Get statistic about queue using
+  long get_stat () const
+  { return use_counter; }
+
+  /// Stores Tvalues.
+  /** \param[in] buffer is pointer to Tvalues
+    * \param[in] delay is milliseconds before value could be got
+    * \param[out] handle is for cancel if it isn't 0
+    * \return true if Tvalues put into queue, false if capacity is reached. */
+  bool put (Tvalue* buffer, const unsigned long delay = 0, pdh handle = 0);
+
+  /// Removes value which isn't got yet.
+  /** \return true if value is removed, false if it's got or cancelled already. */
+  bool cancel (const dh& handle);
+
+  /// Retrives Tvalues which due time has passed.
+  /** \param[in] buffer is pointer to Tvalues
+    * \return true if Tvalues get from queue. */
+  bool get (Tvalue* buffer)
+  { return pop (buffer, 0); }
+
+  /// Retrives Tvalues, sleeps till earliest due time or put.
+  /** \param[in] timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if queue is closed. */
+  bool get_wait (Tvalue* buffer, long timeout = TS_INFINITE_TIMEOUT);
+
+  /// Wake all waiters for shutdown
+  void close ()
+  { not_empty.close (); }
+};
+
+template <class Tvalue, class Tallocator, class Tlocker, class Talloc_cache>
+dqueue         <Tvalue,       Tallocator,       Tlocker,       Talloc_cache>
+
+:: ~dqueue ()
+{
+  list_head* lists [TS_DQUEUE_LEVELS * slots_number + 1];
+  long number = 0;
+
+  for (long level = 0; level < TS_DQUEUE_LEVELS; level++)
+    for (long slot = 0; slot < slots_number; slot++)
+      lists [number++] = & wheel [level][slot];
+
+  lists [number++] = & ready;
+
+  for (long i = 0; i < number; i++)
+    while (!list_empty (lists [i]) )
+    {
+      pdn pn = (pdn) lists [i]->next;
+
+      list_del (& pn->lh);
+      pn->value.~Tvalue ();
+      free_node (pn);
+    }
+
+  if (palloc_cache) { delete palloc_cache, palloc_cache = 0; } else { brk (); }
+}
+
+/// Put node into slot by its due time, locker is held
+template <class Tvalue, class Tallocator, class Tlocker, class Talloc_cache>
+void dqueue    <Tvalue,       Tallocator,       Tlocker,       Talloc_cache>
+
+:: insert (pdn pn)
+{
+  if (pn->due < current) ///< tick is processed already
+  { list_add_tail (& pn->lh, & ready); return; }
+
+  ulonglong due   = pn->due;
+  ulonglong delta = due - current;
+
+  long level = 0;
+
+  while (level < TS_DQUEUE_LEVELS - 1
+      && delta >> (TS_DQUEUE_SLOT_BITS * (level + 1) ) )
+    level++;
+
+  if (delta >> (TS_DQUEUE_SLOT_BITS * TS_DQUEUE_LEVELS) ) ///< farther than wheel, it's cascaded again
+    due = current + ( ( (ulonglong) 1 << (TS_DQUEUE_SLOT_BITS * TS_DQUEUE_LEVELS) ) - 1);
+
+  long slot = (long) (due >> (TS_DQUEUE_SLOT_BITS * level) ) & slot_mask;
+
+  list_add_tail (& pn->lh, & wheel [level][slot]);
+
+  mark_slot (level, slot);
+}
+
+/// Move nodes of slot of level to lower levels, higher level is cascaded before
+template <class Tvalue, class Tallocator, class Tlocker, class Talloc_cache>
+void dqueue    <Tvalue,       Tallocator,       Tlocker,       Talloc_cache>
+
+:: cascade (const long level)
+{
+  long slot = (long) (current >> (TS_DQUEUE_SLOT_BITS * level) ) & slot_mask;
+
+  if (!slot && level < TS_DQUEUE_LEVELS - 1)
+    cascade (level + 1);
+
+  list_head* plist = & wheel [level][slot];
+
+  if (list_empty (plist) )
+    return;
+
+  list_head chain;
+
+  INIT_LIST_HEAD (& chain);
+  list_splice (plist, & chain);
+  INIT_LIST_HEAD (plist);
+
+  unmark_slot (level, slot);
+
+  while (!list_empty (& chain) )
+  {
+    pdn pn = (pdn) chain.next;
+
+    list_del (& pn->lh);
+    insert (pn);
+  }
+}
+
+/// Process ticks till now, due nodes are moved to ready list
+template <class Tvalue, class Tallocator, class Tlocker, class Talloc_cache>
+void dqueue    <Tvalue,       Tallocator,       Tlocker,       Talloc_cache>
+
+:: advance (const ulonglong now)
+{
+  while (current <= now)
+  {
+    long slot = (long) current & slot_mask;
+
+    if (!slot)
+      cascade (1);
+
+    list_head* plist = & wheel [0][slot];
+
+    if (!list_empty (plist) )
+    {
+      list_splice (plist, ready.prev);
+      INIT_LIST_HEAD (plist);
+
+      unmark_slot (0, slot);
+    }
+
+    /// jump over empty slots and rounds without cascading
+    ulonglong tick = next_tick ();
+
+    current = tick > now + 1 ? now + 1 : tick;
+  }
+}
+
+/// First not empty slot of level from index, -1 if there isn't it
+template <class Tvalue, class Tallocator, class Tlocker, class Talloc_cache>
+long dqueue    <Tvalue,       Tallocator,       Tlocker,       Talloc_cache>
+
+:: next_slot (const long level, const long index) const
+{
+  if (index >= slots_number)
+    return -1;
+
+  long word = index / word_bits;
+  unsigned long bits = level_bits [level][word] & (~0UL << (index % word_bits) );
+
+  for (;;)
+  {
+    if (bits)
+      return word * word_bits + bit_scan_forward (bits);
+
+    if (++word >= words_number)
+      return -1;
+
+    bits = level_bits [level][word];
+  }
+}
+
+/// Next tick which should be processed, level 0 slot or cascade of higher level slot, ~0 if wheel is empty
+/** Slot of level 0 gives exact due time. Slot k of level n is cascaded at first tick from current
+  * which has index k on level n and zero lower levels, values of slot aren't due before it. Slots
+  * behind index of current are processed in next round of level. */
+template <class Tvalue, class Tallocator, class Tlocker, class Talloc_cache>
+ulonglong dqueue <Tvalue,     Tallocator,       Tlocker,       Talloc_cache>
+
+:: next_tick () const
+{
+  ulonglong tick = ~ (ulonglong) 0;
+
+  for (long level = 0; level < TS_DQUEUE_LEVELS; level++)
+  {
+    long shift = TS_DQUEUE_SLOT_BITS * level;
+    long index = (long) (current >> shift) & slot_mask;
+
+    /// slot of index is cascaded already if current isn't its first tick
+    bool passed = 0 != (current & ( ( (ulonglong) 1 << shift) - 1) );
+
+    long next = next_slot (level, passed ? index + 1 : index);
+    long distance = next - index;
+
+    if (next < 0)
+    {
+      if ( (next = next_slot (level, 0) ) < 0)
+        continue; ///< level is empty
+
+      distance = next + slots_number - index;
+    }
+
+    ulonglong level_tick = level ? ( (current >> shift) + distance) << shift
+                                 : current + distance;
+    if (level_tick < tick)
+      tick = level_tick;
+  }
+
+  return tick;
+}
+
+/// Milliseconds till next tick which should be processed, TS_INFINITE_TIMEOUT if wheel is empty
+template <class Tvalue, class Tallocator, class Tlocker, class Talloc_cache>
+long dqueue    <Tvalue,       Tallocator,       Tlocker,       Talloc_cache>
+
+:: next_due (const ulonglong now) const
+{
+  if (!use_counter)
+    return TS_INFINITE_TIMEOUT;
+
+  ulonglong tick = next_tick ();
+
+  if (~ (ulonglong) 0 == tick)
+    return TS_INFINITE_TIMEOUT;
+
+  if (tick <= now)
+    return 0;
+
+  return tick - now < 0x7FFFFFFF ? (long) (tick - now) : 0x7FFFFFFF;
+}
+
+/// Take due node from ready list
+/** \param[out] left is milliseconds till next due value if there isn't due one */
+template <class Tvalue, class Tallocator, class Tlocker, class Talloc_cache>
+bool dqueue    <Tvalue,       Tallocator,       Tlocker,       Talloc_cache>
+
+:: pop (Tvalue* buffer, long* left)
+{
+  if (!buffer) { brk (); return false; }
+
+  ulonglong now = monotonic_time ();
+
+  wheel_locker.lock ();
+
+  advance (now);
+
+  if (list_empty (& ready) )
+  {
+    if (left)
+      *left = next_due (now);
+
+    wheel_locker.unlock ();
+    return false;
+  }
+
+  pdn pn = (pdn) ready.next;
+
+  list_del (& pn->lh);
+  pn->status = dead_node;
+  use_counter--;
+
+  wheel_locker.unlock ();
+
+  /// copy value from node
+  tstl :: allocator a;
+  :: new ( (void*) buffer, a) Tvalue (pn->value);
+
+  pn->value.~Tvalue ();
+  free_node (pn);
+  return true;
+}
+
+/// Stores Tvalues.
+/** \param[in] buffer is pointer to Tvalues
+  * \param[in] delay is milliseconds before value could be got
+  * \param[out] handle is for cancel if it isn't 0
+  * \return true if Tvalues put into queue, false if capacity is reached. */
+template <class Tvalue, class Tallocator, class Tlocker, class Talloc_cache>
+bool dqueue    <Tvalue,       Tallocator,       Tlocker,       Talloc_cache>
+
+:: put (Tvalue* buffer, const unsigned long delay, pdh handle)
+{
+  if (!buffer || !palloc_cache) { brk (); return false; }
+
+  pdn pn = (pdn) palloc_cache->get (sizeof (*pn) );
+
+  if (!pn)
+    return false; ///< capacity is reached
+
+  /// put value to node
+  tstl :: allocator a;
+  :: new ( (void*) & pn->value, a) Tvalue (*buffer);
+
+  pn->due = monotonic_time () + delay;
+
+  wheel_locker.lock ();
+
+  pn->sequence = sequence++;
+  pn->status   = live_node;
+
+  insert (pn);
+  use_counter++;
+
+  if (handle)
+  {
+    handle->node     = pn;
+    handle->sequence = pn->sequence;
+  }
+
+  wheel_locker.unlock ();
+
+  not_empty.notify_all (); ///< waiter could sleep till later due time
+  return true;
+}
+
+/// Removes value which isn't got yet.
+/** \return true if value is removed, false if it's got or cancelled already. */
+template <class Tvalue, class Tallocator, class Tlocker, class Talloc_cache>
+bool dqueue    <Tvalue,       Tallocator,       Tlocker,       Talloc_cache>
+
+:: cancel (const dh& handle)
+{
+  pdn pn = (pdn) handle.node;
+
+  if (!pn || !palloc_cache || !palloc_cache->is_address_from_cache ( (char*) pn) )
+  { brk (); return false; }
+
+  wheel_locker.lock ();
+
+  if (live_node != pn->status || handle.sequence != pn->sequence)
+  { wheel_locker.unlock (); return false; }
+
+  list_head* prev = pn->lh.prev;
+  list_del (& pn->lh);
+
+  /// node was last one of wheel slot, slot isn't marked more
+  if (prev >= & wheel [0][0] && prev < & wheel [0][0] + TS_DQUEUE_LEVELS * slots_number && list_empty (prev) )
+  {
+    long index = (long) (prev - & wheel [0][0]);
+    unmark_slot (index / slots_number, index % slots_number);
+  }
+  pn->status = dead_node;
+  use_counter--;
+
+  wheel_locker.unlock ();
+
+  pn->value.~Tvalue ();
+  free_node (pn);
+  return true;
+}
+
+/// Retrives Tvalues, sleeps till earliest due time or put.
+/** \param[in] timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever
+  * \return false on timeout or if queue is closed. */
+template <class Tvalue, class Tallocator, class Tlocker, class Talloc_cache>
+bool dqueue    <Tvalue,       Tallocator,       Tlocker,       Talloc_cache>
+
+:: get_wait (Tvalue* buffer, long timeout)
+{
+  deadline time (timeout);
+
+  long left = TS_INFINITE_TIMEOUT;
+
+  if (pop (buffer, & left) ) ///< waiter is announced only when queue seems empty
+    return true;
+
+  for (;;)
+  {
+    long key  = not_empty.prepare_wait ();
+    left = TS_INFINITE_TIMEOUT;
+
+    if (pop (buffer, & left) )
+    { not_empty.cancel_wait (); return true; }
+
+    long rest = time.left ();
+
+    if (!rest || not_empty.is_closed () )
+    { not_empty.cancel_wait (); return false; }
+
+    if (left < 0 || (rest >= 0 && rest < left) )
+      left = rest;
+
+    not_empty.wait (key, left);
+  }
+}
+
+}; /* end of tstl namespace */
+
+#endif /* __DQUEUE_HPP__ */
@@ -0,0 +1,331 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file epipe.hpp
+ *
+ *  Abstract:		\brief Elastic pipe, list of cyclo buffer segments which grows and shrinks by load.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: pipe, melocker (relocker), allocator
+ *  Internal: epipe
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __EPIPE_HPP__
+#define __EPIPE_HPP__
+
+#include "tspipe.hpp"
+
+#define TS_EPIPE_MAX_GROW     6    ///< default max size is init size << it
+#define TS_EPIPE_SHRINK_CHECK 64   ///< usage of write segment is checked once per it puts
+#define TS_EPIPE_SHRINK_LOW   16   ///< checks in row with low usage before shrinking
+
+namespace tstl {
+
+/// Elastic pipe
+/** Writers put values into last segment, reader gets them from first one. When last segment
+  * is full writer links new one of double size and goes on, reader drains old segment and frees
+  * it after. When usage of last segment is low long time writer links new one of half size, so
+  * memory is given back when load subsides. Sum of segments sizes isn't more than max size,
+  * put over it fails and is counted as overflow. Pipe has one reader always. */
+template <class Tvalue, class Tsize = unsigned long, class Tlocker = melocker<>, class Tallocator = allocator>
+
+class epipe
+{
+  typedef pipe <Tvalue, Tsize, Tlocker, Tallocator> ring;
+
+  typedef struct segment : ring
+  {
+    segment* volatile next; ///< newer segment, writer doesn't touch this one after linking
+    const Tsize size;
+
+    segment (const Tsize in_size) : ring (in_size, true), next (0), size (in_size) {}
+  } seg, *pseg;
+
+  const Tsize init_size;
+  const Tsize max_size;
+  const bool single_writer; ///< there is one writer, head_locker isn't used
+
+  char head_pad [TS_CACHE_LINE_SIZE];
+  pseg write_seg;            ///< last segment
+  volatile long put_counter; ///< values put, it's changed by writers
+  long overflows;            ///< puts failed by max size
+  long put_calls;
+  long low_checks;           ///< checks in row with low usage of write segment
+  Tlocker head_locker;       ///< Head protection on multi writers
+
+  char tail_pad [TS_CACHE_LINE_SIZE];
+  pseg read_seg;             ///< first segment
+  volatile long get_counter; ///< values got, it's changed by reader
+
+  char end_pad [TS_CACHE_LINE_SIZE];
+  long allocated;            ///< sum of segments sizes
+
+  /// Link new last segment, writer is locked
+  bool link_segment (const Tsize size);
+
+  /// Size which could be linked yet
+  Tsize get_room () const
+  {
+    Tsize used = (Tsize) atomic_load_relaxed (& allocated);
+    return max_size > used ? max_size - used : 0;
+  }
+
+  /// Free drained first segment if there is next one
+  /** \return new first segment or ps if it isn't drained */
+  pseg retire (pseg ps);
+
+  /// Retrives Tvalues which are cut between segments
+  bool get_cut (Tvalue* buffer, Tsize counter);
+
+public:
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  /** \param in_init_size     - size of first segment
+    * \param in_max_size      - max sum of segments sizes, 0 means in_init_size << TS_EPIPE_MAX_GROW
+    * \param in_single_writer - there is one writer thread, put doesn't lock */
+  epipe (const Tsize in_init_size = 0x1000, const Tsize in_max_size = 0, const bool in_single_writer = false)
+       : init_size (in_init_size < 2 ? 2 : in_init_size),
+         max_size (in_max_size ? in_max_size : (in_init_size < 2 ? 2 : in_init_size) << TS_EPIPE_MAX_GROW),
+         single_writer (in_single_writer),
+         write_seg (0), put_counter (0), overflows (0), put_calls (0), low_checks (0),
+         read_seg (0), get_counter (0), allocated (0)
+  {
+    if (!link_segment (init_size) ) { brk (); return; }
+
+    read_seg = write_seg;
+  }
+
+  ~epipe ()
+  {
+    while (read_seg)
+    {
+      pseg ps = read_seg;
+      read_seg = ps->next;
+      delete ps, ps = 0;
+    }
+  }
+
+  /// Check pipe usage
+  bool is_empty () const
+  { return 0 == get_stat (); }
+
+  /// Get statistic about pipe using
+  long get_stat () const
+  { return atomic_load_acquire (& put_counter) - atomic_load_acquire (& get_counter); }
+
+  /// Get statistic about puts failed by max size
+  long get_overflow_stat () const
+  { return overflows; }
+
+  /// Get statistic about memory, it's sum of segments sizes
+  long get_size_stat () const
+  { return allocated; }
+
+  /// Stores Tvalues.
+  /** \param buffer  - pointer to Tvalues
+    * \param counter - Tvalues counter
+    * \return true if Tvalues put into pipe, false if max size is reached. */
+  bool put (Tvalue* buffer, Tsize counter = 1);
+
+  /// Retrives Tvalues.
+  /** \param buffer  - pointer to Tvalues
+    * \param counter - Tvalues counter
+    * \return true if Tvalues get from pipe. */
+  bool get (Tvalue* buffer, Tsize counter = 1);
+};
+
+/// Link new last segment, writer is locked
+template <class Tvalue, class Tsize, class Tlocker, class Tallocator>
+bool epipe     <Tvalue,       Tsize,       Tlocker,       Tallocator>
+
+:: link_segment (const Tsize size)
+{
+  pseg ps = new segment (size);
+
+  if (!ps) { brk (); return false; }
+
+  if (!ps->free_size () ) ///< storage isn't allocated
+  { brk (); delete ps, ps = 0; return false; }
+
+  atomic_add_return (& allocated, (long) size);
+
+  low_checks = 0;
+
+  if (write_seg) ///< values of old segment are visible before link
+    atomic_store_release (& write_seg->next, ps);
+
+  write_seg = ps;
+  return true;
+}
+
+/// Free drained first segment if there is next one
+/** \return new first segment or ps if it isn't drained */
+template <class Tvalue, class Tsize, class Tlocker, class Tallocator>
+typename epipe <Tvalue, Tsize, Tlocker, Tallocator> :: pseg epipe <Tvalue, Tsize, Tlocker, Tallocator>
+
+:: retire (pseg ps)
+{
+  pseg next = atomic_load_acquire (& ps->next); ///< next is read before usage
+
+  if (!next || ps->used_size () )
+    return ps;
+
+  read_seg = next;
+
+  atomic_add_return (& allocated, - (long) ps->size);
+
+  delete ps, ps = 0;
+  return next;
+}
+
+/// Stores Tvalues.
+/** \param buffer  - pointer to Tvalues
+  * \param counter - Tvalues counter
+  * \return true if Tvalues put into pipe, false if max size is reached. */
+template <class Tvalue, class Tsize, class Tlocker, class Tallocator>
+bool epipe     <Tvalue,       Tsize,       Tlocker,       Tallocator>
+
+:: put (Tvalue* buffer, Tsize counter)
+{
+  if (!buffer || !write_seg)
+    return false;
+
+  if (!counter)
+    return true;
+
+  if (!single_writer) head_locker.lock ();
+
+  pseg ps = write_seg;
+  bool rc = ps->put (buffer, counter);
+
+  if (!rc)
+  { /// segment is full, link double one
+    Tsize size = ps->size;
+
+    do size <<= 1; while (size <= counter);
+
+    if (size > get_room () )
+      size = get_room ();
+
+    rc = size > counter
+      && link_segment (size)
+      && write_seg->put (buffer, counter);
+
+    if (!rc)
+      overflows++;
+  }
+  else
+  if (ps->size > init_size
+   && !(++put_calls % TS_EPIPE_SHRINK_CHECK) )
+  { /// segment is big, link half one if usage is low long time
+    if (ps->used_size () < ps->size / 4)
+    {
+      Tsize size = ps->size / 2 < init_size ? init_size : ps->size / 2;
+
+      if (++low_checks >= TS_EPIPE_SHRINK_LOW
+       && size <= get_room () )
+        link_segment (size);
+    }
+    else
+      low_checks = 0;
+  }
+
+  if (rc)
+    atomic_store_release (& put_counter, put_counter + (long) counter);
+
+  if (!single_writer) head_locker.unlock ();
+
+  return rc;
+}
+
+/// Retrives Tvalues.
+/** \param buffer  - pointer to Tvalues
+  * \param counter - Tvalues counter
+  * \return true if Tvalues get from pipe. */
+template <class Tvalue, class Tsize, class Tlocker, class Tallocator>
+bool epipe     <Tvalue,       Tsize,       Tlocker,       Tallocator>
+
+:: get (Tvalue* buffer, Tsize counter)
+{
+  if (!buffer || !read_seg)
+    return false;
+
+  if (!counter)
+    return true;
+
+  for (;;)
+  {
+    pseg ps = read_seg;
+
+    if (ps->get (buffer, counter) )
+      break;
+
+    if (!atomic_load_acquire (& ps->next) )
+      return false; ///< there is one segment without enough values
+
+    if (ps == retire (ps) ) ///< values are cut between segments
+      return get_cut (buffer, counter);
+  }
+
+  atomic_store_release (& get_counter, get_counter + (long) counter);
+  return true;
+}
+
+/// Retrives Tvalues which are cut between segments
+template <class Tvalue, class Tsize, class Tlocker, class Tallocator>
+bool epipe     <Tvalue,       Tsize,       Tlocker,       Tallocator>
+
+:: get_cut (Tvalue* buffer, Tsize counter)
+{
+  Tsize available = 0;
+
+  /// count values before copying, they could only come more
+  for (pseg ps = read_seg; ps; ps = atomic_load_acquire (& ps->next) )
+    available += ps->used_size ();
+
+  if (available < counter)
+    return false;
+
+  pseg ps = read_seg;
+  Tsize pos = 0;
+
+  while (pos < counter)
+  {
+    Tsize part = ps->used_size ();
+
+    if (part > counter - pos)
+      part = counter - pos;
+
+    if (part && !ps->get (& buffer [pos], part) )
+    { brk (); return false; }
+
+    pos += part;
+
+    if (pos < counter)
+    {
+      pseg next = retire (ps);
+
+      if (next == ps) { brk (); return false; }
+
+      ps = next;
+    }
+  }
+
+  atomic_store_release (& get_counter, get_counter + (long) counter);
+  return true;
+}
+
+}; /* end of tstl namespace */
+
+#endif /* __EPIPE_HPP__ */
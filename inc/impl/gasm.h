@@ -22,12 +22,11 @@
 
 static inline long InterlockedIncrement (long* Addend)
 {
-  const long one = 1;
   long res;
-  asm (	"	lock xadd %0,(%1)\n"
-	"	incl	%0"
+  asm volatile (	"	lock xadd %0,(%1)\n"
+	"	inc	%0"
 	: "=r" (res)
-	: "r" (Addend), "0" (1)
+	: "r" (Addend), "0" (1L)
 	: "memory", "flags");
   return res;
 }
@@ -35,10 +34,10 @@ static inline long InterlockedIncrement (long* Addend)
 static inline long InterlockedDecrement (long* Addend)
 {
   long res;
-  asm (	"	lock xadd %0,(%1)\n"
-	"	decl	%0"
+  asm volatile (	"	lock xadd %0,(%1)\n"
+	"	dec	%0"
 	: "=r" (res)
-	: "r" (Addend), "0" (-1)
+	: "r" (Addend), "0" (-1L)
 	: "memory", "flags");
   return res;
 }
@@ -46,7 +45,7 @@ static inline long InterlockedDecrement (long* Addend)
 static inline long InterlockedExchangeAdd (long* Addend, long Value)
 {
   long res;
-  asm (	"	lock xadd %0,(%1)"
+  asm volatile (	"	lock xadd %0,(%1)"
 	: "=r" (res)
 	: "r" (Addend), "0" (Value)
 	: "memory", "flags");
@@ -56,7 +55,7 @@ static inline long InterlockedExchangeAdd (long* Addend, long Value)
 static inline long interlocked_exchange (long* destination, long exchange)
 {
   long res;
-  asm (	"1:	lock cmpxchg %1,(%0)"
+  asm volatile (	"1:	lock cmpxchg %2,(%1)\n"
   	"	jnz     1b\n"
 	: "=a" (res)
 	: "r" (destination), "r" (exchange), "a" (*destination)
@@ -67,7 +66,7 @@ static inline long interlocked_exchange (long* destination, long exchange)
 static inline long interlocked_compare_exchange (long* destination, long exchange, long comperand)
 {
   long res;
-  asm (	"	lock cmpxchg %1,(%0)"
+  asm volatile (	"	lock cmpxchg %2,(%1)"
 	: "=a" (res)
 	: "r" (destination), "r" (exchange), "a" (comperand)
 	: "memory", "flags");
@@ -0,0 +1,439 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file gqalloccache.hpp
+ *
+ *  Abstract:		\brief Growable memory allocating cache, it chains slabs of interlocked queue caches.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: iqalloc_cache, melocker, allocator, atomic_load_acquire, atomic_store_release
+ *  Internal: gqalloc_cache
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __GQALLOCCACHE_HPP__
+#define __GQALLOCCACHE_HPP__
+
+#include "impl/iqalloccache.hpp"
+#include "impl/melocker.hpp"
+
+#define TS_MAX_SLABS 16
+
+/// Slabs stop doubling on this number of buffers, packed tail index of iqalloc_cache limits it on 32 bits targets
+#if defined (TS_ALLOC_INDEX_MASK)
+#  define TS_MAX_SLAB_ELEM ( (long) TS_ALLOC_INDEX_MASK)
+#else
+#  define TS_MAX_SLAB_ELEM ( (long) (~0UL >> 2) )
+#endif
+
+namespace tstl {
+
+/// Growable allocating cache
+/** When all slabs are empty, new slab twice bigger than previous one is added under Tlocker,
+  * so buffers go to global mempool only when all Tmax_slabs slabs are used. Owner of buffer
+  * is found by range compare over slabs. Idle slabs are returned to allocator by trim
+  * while remaining capacity isn't lower than high water mark. Constructor has the same
+  * first parameters as other caches, so it could be Talloc_cache of alloc_cache_array. */
+template <class Tvalue = char, class Tallocator = allocator, class Taux_allocator = Tallocator,
+          class Talloc_cache = iqalloc_cache <Tvalue, Tallocator, Taux_allocator>,
+          class Tlocker = melocker<>, long Tmax_slabs = TS_MAX_SLABS>
+
+class gqalloc_cache
+{
+  typedef struct slab_descriptor
+  {
+    Talloc_cache* cache;
+    Tvalue*       begin;      ///< storage of slab
+    Tvalue*       end;
+    long          max_elem;
+    volatile long status;     ///< TS_LIVE_SIGN, TS_KILL_SIGN while trim checks slab, TS_FREE_SIGN
+    volatile long ref;        ///< get and revert in progress
+  } sd, *psd;
+
+  sd slabs [Tmax_slabs];
+
+  volatile long slabs_number; ///< max used descriptor + 1
+  volatile long generation;   ///< it's changed by every grow and trim
+  volatile long current;      ///< slab of last successful get
+
+  Tlocker grow_locker;
+
+  long capacity;              ///< blocks of live slabs
+  long high_water;            ///< trim keeps this capacity
+
+  long use_counter;           ///< using counter
+  long peak_counter;          ///< max of using counter
+  long fallback_counter;      ///< buffers asked from global mempool
+  long live_slabs;
+
+  const size_t buffer_size;
+  const long   first_elem;
+  const long   try_counter;
+  const bool   dont_use_global_mempool; /// allocating behaviour
+  Tvalue* const adopted_storage;        ///< storage of first slab given by owner, it isn't deallocated
+
+      Tallocator     allocator;
+
+  Tvalue* get_from_global_mempool (const size_t size)
+  {
+    atomic_inc_relaxed (& fallback_counter);
+
+    if (dont_use_global_mempool)
+      return 0;
+
+    return (Tvalue*) allocator.allocate (sizeof (Tvalue) * size);
+  }
+
+  bool revert_to_global_mempool (Tvalue* buffer)
+  {
+    if (!buffer) { brk (); return false; }
+
+    if (dont_use_global_mempool)
+      return false;
+
+	allocator.deallocate ( (char*) buffer), buffer = 0;
+    return true;
+  }
+
+  /// Slab of buffer or -1
+  long owner_slab (Tvalue* buffer) const
+  {
+    for (long i = slabs_number - 1; i >= 0; i--)
+    {
+      const sd* ps = & slabs [i];
+
+      if (TS_FREE_SIGN != atomic_load_acquire (& ps->status)
+       && buffer >= ps->begin && buffer < ps->end)
+        return i;
+    }
+
+    return -1;
+  }
+
+  Tvalue* get_from_slab (long index, const size_t size)
+  {
+    psd ps = & slabs [index];
+
+    if (TS_LIVE_SIGN != ps->status)
+      return 0;
+
+    atomic_inc ( (long*) & ps->ref);
+
+    Tvalue* buffer = TS_LIVE_SIGN == atomic_load_acquire (& ps->status) ? ps->cache->get (size) : 0; ///< trim could come
+
+    atomic_dec ( (long*) & ps->ref);
+
+    if (buffer && current != index)
+      current = index;
+
+    return buffer;
+  }
+
+  void free_slab (psd ps)
+  {
+    delete ps->cache, ps->cache = 0;
+
+    if (ps->begin != adopted_storage)
+      allocator.deallocate (ps->begin);
+
+    ps->begin = ps->end = 0;
+    ps->max_elem = 0;
+  }
+
+  /// Buffers number of slab, it's doubled by every slab till TS_MAX_SLAB_ELEM and size_t limit
+  long slab_elem (const long index) const
+  {
+    long max_elem = first_elem;
+    long limit = TS_MAX_SLAB_ELEM;
+
+    if ( (size_t) limit > ( (size_t) -1) / 2 / (sizeof (Tvalue) * buffer_size) )
+      limit = (long) ( ( (size_t) -1) / 2 / (sizeof (Tvalue) * buffer_size) );
+
+    for (long i = 0; i < index && max_elem <= limit / 2; i++)
+      max_elem <<= 1;
+
+    return max_elem < limit ? max_elem : limit;
+  }
+
+  bool grow (long seen_generation);
+
+public:
+
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  /** \param num_elem is buffers number of first slab, every next slab is twice bigger
+    * \param in_storage is adopted storage of num_elem buffers for first slab, it isn't deallocated by cache
+    * \param in_high_water is capacity kept by trim, 0 means num_elem */
+   gqalloc_cache (const size_t in_buffer_size = 0x400,
+                  const long num_elem       = TS_MAX_TRY_COUNTER,
+                  const long in_try_counter = TS_MAX_TRY_COUNTER,
+                  const bool in_dont_use_global_mempool = false,
+                  Tvalue* in_storage = 0,
+                  const long in_high_water  = 0);
+
+  ~gqalloc_cache ()
+  {
+    for (long i = 0; i < Tmax_slabs; i++)
+      if (TS_FREE_SIGN != slabs [i].status)
+        free_slab (& slabs [i]);
+  }
+
+  bool is_empty () const
+  { return 0 == use_counter; }
+
+  /// Get statistic about cache using
+  long get_stat () const
+  { return use_counter; }
+
+  /// Get max of using counter
+  long get_peak_stat () const
+  { return peak_counter; }
+
+  /// Get number of buffers asked from global mempool
+  long get_fallback_stat () const
+  { return fallback_counter; }
+
+  /// Get number of live slabs
+  long get_slabs_stat () const
+  { return live_slabs; }
+
+  bool is_address_from_cache (Tvalue* buffer) const
+  { return owner_slab (buffer) >= 0; }
+
+  bool is_size_enough (const size_t size) const
+  { return buffer_size >= size; }
+
+  /** \param size is amount of symbols <Tvalue> in buffer */
+  Tvalue* get (const size_t size);
+
+  bool revert (Tvalue* buffer);
+
+  /// Return idle slabs to allocator, the first slab and high water capacity are kept
+  /** \return number of released slabs */
+  long trim ();
+};
+
+template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache, class Tlocker, long Tmax_slabs>
+gqalloc_cache  <Tvalue,       Tallocator,       Taux_allocator,       Talloc_cache,       Tlocker,      Tmax_slabs>
+
+:: gqalloc_cache (const size_t in_buffer_size,
+                  const long num_elem,
+                  const long in_try_counter,
+                  const bool in_dont_use_global_mempool,
+                  Tvalue* in_storage,
+                  const long in_high_water)
+                : slabs_number (0), generation (0), current (0), capacity (0),
+                  high_water (in_high_water ? in_high_water : num_elem),
+                  use_counter (0), peak_counter (0), fallback_counter (0), live_slabs (0),
+                  buffer_size (in_buffer_size), first_elem (num_elem), try_counter (in_try_counter),
+                  dont_use_global_mempool (in_dont_use_global_mempool), adopted_storage (in_storage)
+{
+  memset (slabs, 0, sizeof (slabs) );
+
+  for (long i = 0; i < Tmax_slabs; i++)
+    slabs [i].status = TS_FREE_SIGN;
+
+  if (!buffer_size || num_elem <= 0) { brk (); return; }
+
+  grow (generation);
+}
+
+/// Add slab if nobody did it after seen_generation
+/** New cache is checked before slab is published, slab is freed on fail.
+  * \return false if there isn't free slab descriptor or memory */
+template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache, class Tlocker, long Tmax_slabs>
+bool gqalloc_cache <Tvalue,   Tallocator,       Taux_allocator,       Talloc_cache,       Tlocker,      Tmax_slabs>
+
+:: grow (long seen_generation)
+{
+  grow_locker.lock ();
+
+  if (seen_generation != generation)
+  { grow_locker.unlock (); return true; } ///< somebody changed slabs, try them
+
+  long i = 0;
+
+  for (; i < Tmax_slabs; i++)
+    if (TS_FREE_SIGN == slabs [i].status)
+      break;
+
+  if (i >= Tmax_slabs)
+  { grow_locker.unlock (); return false; }
+
+  psd ps = & slabs [i];
+
+  ps->max_elem = slab_elem (i);
+  ps->begin    = !i && adopted_storage ? adopted_storage
+               : (Tvalue*) allocator.allocate (sizeof (Tvalue) * buffer_size * ps->max_elem);
+
+  if (!ps->begin)
+  { brk (); ps->max_elem = 0; grow_locker.unlock (); return false; }
+
+  ps->end   = ps->begin + buffer_size * ps->max_elem;
+  ps->cache = new Talloc_cache (buffer_size, ps->max_elem, try_counter, true, ps->begin);
+
+  /// cache could fail in constructor, then it doesn't own storage
+  if (!ps->cache || !ps->cache->is_address_from_cache (ps->begin) )
+  { brk (); free_slab (ps); grow_locker.unlock (); return false; }
+
+  atomic_store_release (& ps->status, (long) TS_LIVE_SIGN);
+
+  capacity += ps->max_elem;
+  live_slabs++;
+
+  if (i >= slabs_number)
+    slabs_number = i + 1;
+
+  current = i;
+  atomic_inc ( (long*) & generation);
+
+  grow_locker.unlock ();
+  return true;
+}
+
+/// get buffer
+/** \param size is amount of symbols <Tvalue> in buffer */
+template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache, class Tlocker, long Tmax_slabs>
+Tvalue* gqalloc_cache <Tvalue, Tallocator,      Taux_allocator,       Talloc_cache,       Tlocker,      Tmax_slabs>
+
+:: get (const size_t size)
+{
+  if (!size)
+  { brk (); return 0; }
+
+  if (size > buffer_size)
+    return get_from_global_mempool (size);
+
+  Tvalue* buffer = 0;
+
+  for (;;)
+  {
+    long seen_generation = generation;
+    long start = current;
+
+    buffer = get_from_slab (start, size);
+
+    for (long i = slabs_number - 1; !buffer && i >= 0; i--)
+      if (i != start)
+        buffer = get_from_slab (i, size);
+
+    if (buffer || !grow (seen_generation) )
+      break;
+  }
+
+  if (!buffer)
+    return get_from_global_mempool (size);
+
+  long used = atomic_inc_return (& use_counter);
+
+  for (long peak = peak_counter; used > peak; peak = peak_counter)
+    if (peak == atomic_compare_exchange (& peak_counter, used, peak) )
+      break;
+
+  return buffer;
+}
+
+template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache, class Tlocker, long Tmax_slabs>
+bool gqalloc_cache <Tvalue,   Tallocator,       Taux_allocator,       Talloc_cache,       Tlocker,      Tmax_slabs>
+
+:: revert (Tvalue* buffer)
+{
+  if (!buffer) { brk (); return false; }
+
+  long i = owner_slab (buffer);
+
+  if (i < 0)
+  {
+    if (dont_use_global_mempool)
+    { brk (); /* it's alien pointer */ }
+
+    revert_to_global_mempool (buffer);
+    return false;
+  }
+
+  psd ps = & slabs [i];
+
+  atomic_inc ( (long*) & ps->ref); ///< trim waits for it
+  bool rc   = ps->cache->revert (buffer);
+  bool idle = ps->cache->is_empty ();
+  long rest = capacity - ps->max_elem;
+  atomic_dec ( (long*) & ps->ref);
+
+  if (!rc) { brk (); return false; }
+
+  atomic_dec (& use_counter);
+
+  /// high water trim policy: idle slab is released when the rest keeps high water
+  /// and twice of current using, so bursts around slab border don't grow and trim it again
+  if (i && idle && rest >= high_water && use_counter < rest / 2)
+    trim ();
+
+  return true;
+}
+
+template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache, class Tlocker, long Tmax_slabs>
+long gqalloc_cache <Tvalue,   Tallocator,       Taux_allocator,       Talloc_cache,       Tlocker,      Tmax_slabs>
+
+:: trim ()
+{
+  long released = 0;
+
+  grow_locker.lock ();
+
+  for (long i = slabs_number - 1; i > 0; i--)
+  {
+    psd ps = & slabs [i];
+
+    if (TS_LIVE_SIGN != ps->status
+     || !ps->cache->is_empty ()
+     || capacity - ps->max_elem < high_water)
+      continue;
+
+    /// new gets skip killed slab, gets and reverts in progress are waited
+    atomic_exchange ( (long*) & ps->status, TS_KILL_SIGN);
+
+    while (ps->ref)
+      ts_yield_processor ();
+
+    /// revert increments ref before it frees buffer, so ref is checked again
+    if (!ps->cache->is_empty () || (atomic_fence (), ps->ref) )
+    {
+      atomic_exchange ( (long*) & ps->status, TS_LIVE_SIGN);
+      continue;
+    }
+
+    capacity -= ps->max_elem;
+
+    free_slab (ps);
+    atomic_store_release (& ps->status, (long) TS_FREE_SIGN);
+    live_slabs--;
+    released++;
+  }
+
+  while (slabs_number > 1 && TS_FREE_SIGN == slabs [slabs_number - 1].status)
+    slabs_number--;
+
+  if (current >= slabs_number || TS_LIVE_SIGN != slabs [current].status)
+    current = 0;
+
+  if (released)
+    atomic_inc ( (long*) & generation);
+
+  grow_locker.unlock ();
+
+  return released;
+}
+
+}; /* end of tstl namespace */
+
+#endif /* __GQALLOCCACHE_HPP__ */
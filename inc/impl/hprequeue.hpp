@@ -0,0 +1,264 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file hprequeue.hpp
+ *
+ *  Abstract:		\brief Heap priority queue, pairing heap for sparse and continuous prioritets.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: alloc_cache, melocker (relocker), allocator, eventcount
+ *  Internal: hprequeue, min_top, max_top
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __HPREQUEUE_HPP__
+#define __HPREQUEUE_HPP__
+
+#include "alloccache.hpp"
+#include "impl/tsevent.hpp"
+
+namespace tstl {
+
+/// Smaller prioritet is more urgent (deadlines, timestamps)
+struct min_top
+{ static bool above (const long a, const long b) { return a < b; } };
+
+/// Bigger prioritet is more urgent
+struct max_top
+{ static bool above (const long a, const long b) { return a > b; } };
+
+/// Heap priority queue
+/** Every message is node of pairing heap, so there isn't queue object per prioritet and any
+  * long could be prioritet. Put melds node with root by O(1), get_top removes root and melds
+  * its children by two passes, amortized O(log n). Messages with same prioritet go by FIFO.
+  * Nodes are taken from allocating cache and values are copied out of locker, heap links only
+  * are changed under Tlocker. It's engine of prequeue with get_top, get of exact prioritet
+  * isn't there, it would walk heap. */
+template <class Tvalue, class Tallocator = allocator, class Ttop = min_top, class Tlocker = melocker<>,
+          class Talloc_cache = iqalloc_cache <char, Tallocator, Tallocator> >
+
+class hprequeue
+{
+  typedef struct heap_node
+  {
+    heap_node* child;       ///< first child
+    heap_node* sibling;     ///< next sibling
+    long prioritet;
+    unsigned long sequence; ///< put order of same prioritets
+    Tvalue value;
+  } hn, *phn;
+
+  phn root;
+  unsigned long sequence;
+  long use_counter;
+
+  Tlocker heap_locker;
+
+  Talloc_cache* palloc_cache;
+
+  Tallocator allocator;
+
+  eventcount not_empty; ///< readers wait on it
+
+  static bool above (const phn a, const phn b)
+  {
+    if (a->prioritet != b->prioritet)
+      return Ttop :: above (a->prioritet, b->prioritet);
+
+    return (long) (a->sequence - b->sequence) < 0;
+  }
+
+  /// Meld two heaps, roots haven't siblings
+  static phn meld (phn a, phn b)
+  {
+    if (!a) return b;
+    if (!b) return a;
+
+    if (above (b, a))
+    { phn t = a; a = b, b = t; }
+
+    b->sibling = a->child, a->child = b;
+    return a;
+  }
+
+  /// Meld children of removed root, left to right by pairs and right to left after
+  static phn merge_pairs (phn first)
+  {
+    phn pairs = 0; ///< melded pairs in reverse order
+
+    while (first)
+    {
+      phn a = first, b = a->sibling;
+
+      if (!b)
+      { a->sibling = pairs, pairs = a; break; }
+
+      first = b->sibling;
+      a->sibling = b->sibling = 0;
+
+      a = meld (a, b);
+      a->sibling = pairs, pairs = a;
+    }
+
+    phn top = 0;
+
+    while (pairs)
+    {
+      phn next = pairs->sibling;
+
+      pairs->sibling = 0;
+      top = meld (top, pairs);
+      pairs = next;
+    }
+
+    return top;
+  }
+
+  void free_node (phn pn)
+  {
+    if (palloc_cache)
+      palloc_cache->revert ( (char*) pn), pn = 0;
+    else
+      allocator.deallocate ( (char*) pn), pn = 0;
+  }
+
+public:
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  /// Second size of prequeue constructor isn't used
+  hprequeue (const long alloc_cache_elem = 64, const unsigned long = 0) : root (0), sequence (0), use_counter (0)
+  {
+    palloc_cache = new Talloc_cache (sizeof (hn), alloc_cache_elem);
+    if (!palloc_cache) { brk (); }
+  }
+
+  ~hprequeue ()
+  {
+    Tvalue buffer;
+    while (get_top (& buffer) ) {}
+
+    if (palloc_cache) { delete palloc_cache, palloc_cache = 0; } else { brk (); }
+  }
+
+  /// Is not thread safe method
+  bool is_empty () const
+  { return 0 == use_counter; }
+
+  /// Get statistic about queue using
+  long get_stat () const
+  { return use_counter; }
+
+  /// Stores Tvalues.
+  /** \param[in] buffer is pointer to Tvalues
+    * \param[in] prioritet is any long, Ttop tells which one is more urgent
+    * \return true if Tvalues put into queue. */
+  bool put (Tvalue* buffer, long prioritet = 0);
+
+  /// Retrives Tvalues of most urgent prioritet.
+  /** \param[in] buffer is pointer to Tvalues
+    * \param[out] prioritet is prioritet of Tvalues if it isn't 0
+    * \return true if Tvalues get from queue. */
+  bool get_top (Tvalue* buffer, long* prioritet = 0);
+
+  /// Queue isn't bounded, it's put
+  bool put_wait (Tvalue* buffer, long prioritet = 0, long /* timeout */ = TS_INFINITE_TIMEOUT)
+  { return put (buffer, prioritet); }
+
+  /// Retrives Tvalues of most urgent prioritet, waits while queue is empty.
+  /** \param[in] timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if queue is closed and empty. */
+  bool get_top_wait (Tvalue* buffer, long* prioritet = 0, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    bool rc = false;
+    ts_event_wait (not_empty, get_top (buffer, prioritet), timeout, rc);
+    return rc;
+  }
+
+  /// Wake all waiters for shutdown
+  void close ()
+  { not_empty.close (); }
+};
+
+/// Stores Tvalues.
+/** \param[in] buffer is pointer to Tvalues
+  * \param[in] prioritet is any long, Ttop tells which one is more urgent
+  * \return true if Tvalues put into queue. */
+template <class Tvalue, class Tallocator, class Ttop, class Tlocker, class Talloc_cache>
+bool hprequeue <Tvalue,       Tallocator,       Ttop,       Tlocker,       Talloc_cache>
+
+:: put (Tvalue* buffer, long prioritet)
+{
+  if (!buffer) { brk (); return false; }
+
+  /// get piece of memory
+  phn pn = palloc_cache ? (phn) palloc_cache->get  (sizeof (*pn) )
+                        : (phn) allocator.allocate (sizeof (*pn) );
+  if (!pn)
+  { brk (); return false; }
+
+  /// put value to temporary buffer
+  tstl :: allocator a;
+  :: new ( (void*) & pn->value, a) Tvalue (*buffer);
+
+  pn->child = pn->sibling = 0;
+  pn->prioritet = prioritet;
+
+  heap_locker.lock ();
+
+  pn->sequence = sequence++;
+  root = meld (root, pn);
+  use_counter++;
+
+  heap_locker.unlock ();
+
+  not_empty.notify_all ();
+  return true;
+}
+
+/// Retrives Tvalues of most urgent prioritet.
+/** \param[in] buffer is pointer to Tvalues
+  * \param[out] prioritet is prioritet of Tvalues if it isn't 0
+  * \return true if Tvalues get from queue. */
+template <class Tvalue, class Tallocator, class Ttop, class Tlocker, class Talloc_cache>
+bool hprequeue <Tvalue,       Tallocator,       Ttop,       Tlocker,       Talloc_cache>
+
+:: get_top (Tvalue* buffer, long* prioritet)
+{
+  if (!buffer) { brk (); return false; }
+
+  heap_locker.lock ();
+
+  phn pn = root;
+
+  if (!pn)
+  { heap_locker.unlock (); return false; }
+
+  root = merge_pairs (pn->child);
+  use_counter--;
+
+  heap_locker.unlock ();
+
+  /// copy value from temporary buffer
+  tstl :: allocator a;
+  :: new ( (void*) buffer, a) Tvalue (pn->value);
+
+  if (prioritet)
+    *prioritet = pn->prioritet;
+
+  free_node (pn);
+  return true;
+}
+
+}; /* end of tstl namespace */
+
+#endif /* __HPREQUEUE_HPP__ */
@@ -41,6 +41,7 @@ class ialloc_cache
 
   const size_t buffer_size;
   const bool dont_use_global_mempool; /// allocating behaviour
+  const bool own_storage;             /// storage was allocated by cache
 
   Taux_allocator aux_allocator;
       Tallocator     allocator;
@@ -72,17 +73,21 @@ public:
   void operator delete (void* p)
   { Tallocator allocator; allocator.deallocate (p); }
 
+  /** \param in_storage is adopted storage of num_elem buffers, it isn't deallocated by cache */
    ialloc_cache (const size_t in_buffer_size = 0x400,
                  const long num_elem         = TS_MAX_SEARCH_DEPTH,
                  const long in_search_depth  = TS_MAX_SEARCH_DEPTH,
-                 const bool in_dont_use_global_mempool = false);
+                 const bool in_dont_use_global_mempool = false,
+                 Tvalue* in_storage = 0);
 
   ~ialloc_cache ()
   {
     max_elem = 0;
 
     if (ref_storage) aux_allocator.deallocate (ref_storage), ref_storage = 0;
-    if (storage)         allocator.deallocate     (storage),     storage = 0;
+    if (storage && own_storage) allocator.deallocate (storage);
+
+    storage = 0;
   }
 
   bool is_empty () const
@@ -102,7 +107,7 @@ public:
   }
 
   bool is_size_enough (const size_t size) const
-  { return buffer_size <= size; }
+  { return buffer_size >= size; }
 
   /** \param size is amount of symbols <Tvalue> in buffer */
   Tvalue* get (const size_t size = buffer_size);
@@ -114,12 +119,13 @@ template <class Tvalue, class Tallocator, class Taux_allocator>
 ialloc_cache   <Tvalue,       Tallocator,       Taux_allocator>
 
 :: ialloc_cache (const size_t in_buffer_size,
-                 const long num_elem        = TS_MAX_SEARCH_DEPTH,
-                 const long in_search_depth = TS_MAX_SEARCH_DEPTH,
-                 const bool in_dont_use_global_mempool = false)
-               : max_elem (num_elem), alloc_elem (0),
+                 const long num_elem,
+                 const long in_search_depth,
+                 const bool in_dont_use_global_mempool,
+                 Tvalue* in_storage)
+               : storage (0), ref_storage (0), max_elem (num_elem), alloc_elem (0),
                  use_counter (0), buffer_size (in_buffer_size),
-                 dont_use_global_mempool (in_dont_use_global_mempool)
+                 dont_use_global_mempool (in_dont_use_global_mempool), own_storage (!in_storage)
 {
   ref_storage = (long*) aux_allocator.allocate (sizeof (*ref_storage) * max_elem);
 
@@ -127,7 +133,8 @@ ialloc_cache   <Tvalue,       Tallocator,       Taux_allocator>
 
   memset (ref_storage, 0, sizeof (*ref_storage) * max_elem);
 
-  storage = (Tvalue*) allocator.allocate (sizeof (*storage) * buffer_size * max_elem);
+  storage = in_storage ? in_storage
+                       : (Tvalue*) allocator.allocate (sizeof (*storage) * buffer_size * max_elem);
 
   if (!storage)
   { brk (); aux_allocator.deallocate (ref_storage), ref_storage = 0; return; }
@@ -10,7 +10,8 @@
  *
  *  Classes, methods and structures: \details
  *
- *  External: atomic_inc_return, atomic_dec_return, allocator
+ *  External: atomic_compare_exchange_dw, atomic_exchange_acq_rel, atomic_load_acquire, atomic_store_release, allocator,
+ *            numa_allocate, numa_deallocate
  *  Internal: ialloc_cache
  *
  *  TODO:		\todo
@@ -21,10 +22,24 @@
 #define __IQALLOCCACHE_HPP__
 
 #include "tstl.hpp"
+#include "impl/tsnuma.h"
 
 #define TS_MAX_TRY_COUNTER TS_SPINLOCK_COUNTER
-#define TS_ALLOC_INDEX_SIZE   (sizeof (short) * 8)
-#define TS_UNUSED_ALLOC_INDEX ( (1 << TS_ALLOC_INDEX_SIZE) - 1)
+#define TS_UNUSED_ALLOC_INDEX (-1L)
+
+/// without double width exchange tail index and deep counter are packed into halves of one long,
+/// it's 32 bits index and 32 bits counter on 64 bits targets
+#if !defined (TS_HAS_LOCK_FREE_DWCAS)
+#  define TS_ALLOC_INDEX_SIZE (sizeof (long) * 4)
+#  define TS_ALLOC_INDEX_MASK ( (1UL << TS_ALLOC_INDEX_SIZE) - 1)
+#endif
+
+/// padding of control fields costs 4 cache lines per cache, it's compile option for caches with contended get and revert
+#if defined (TS_ALLOC_CACHE_PADDING)
+#  define TS_ALLOC_CACHE_PAD(name) char name [TS_CACHE_LINE_SIZE];
+#else
+#  define TS_ALLOC_CACHE_PAD(name)
+#endif
 
 namespace tstl {
 
@@ -36,30 +51,58 @@ class iqalloc_cache
   Taux_allocator aux_allocator;
   Tallocator         allocator;
 
-  #include <pshpack2.h>
-
-  typedef struct queue_pos
+  /// tail position, deep counter protects it from ABA
+  typedef struct TS_DWORD_ALIGNED queue_pos
   {
-    volatile long index        : TS_ALLOC_INDEX_SIZE;
-    volatile long deep_counter : (sizeof (long) * 8) - TS_ALLOC_INDEX_SIZE;
+    ts_word index;
+    ts_word deep_counter;
   } qp, *pqp;
 
-  #include <poppack.h>
-
-  typedef struct queue_elem { Tvalue* buffer; queue_pos next; } qe, *pqe;
+  typedef struct queue_elem { Tvalue* buffer; volatile long next; } qe, *pqe;
 
   qe* ref_storage;   ///< free buffers queue storage
   Tvalue* storage;   ///< storage of buffers
+  void* raw_storage; ///< own storage, aligned storage is in it
 
-  queue_elem *volatile head;
-  queue_pos tail;
+  size_t ref_numa_size;     ///< bytes of ref_storage if it's placed on numa node
+  size_t storage_numa_size; ///< bytes of raw_storage if it's placed on numa node
 
   const bool dont_use_global_mempool; /// allocating behaviour
   const size_t buffer_size;
 
   long max_elem;     ///< storage elements number
-  long use_counter;  ///< using counter
   long try_counter;  ///< tail update counter
+  const long numa_node;
+
+  /// head, tail and counter are changed by different threads, they are on own cache lines with TS_ALLOC_CACHE_PADDING
+  TS_ALLOC_CACHE_PAD (head_pad)
+  queue_elem *volatile head;
+
+  TS_ALLOC_CACHE_PAD (tail_pad)
+#if defined (TS_HAS_LOCK_FREE_DWCAS)
+  volatile queue_pos tail;
+#else
+  volatile long tail;
+#endif
+
+  TS_ALLOC_CACHE_PAD (counter_pad)
+  long use_counter;  ///< using counter
+
+  TS_ALLOC_CACHE_PAD (end_pad)
+
+  /// Block size in Tvalues, aligned block is multiple of cache line
+  static size_t block_size (const size_t size, const bool aligned)
+  {
+    if (!aligned)
+      return size;
+
+    size_t bytes = (sizeof (Tvalue) * size + TS_CACHE_LINE_SIZE - 1) & ~(size_t) (TS_CACHE_LINE_SIZE - 1);
+
+    return (bytes + sizeof (Tvalue) - 1) / sizeof (Tvalue);
+  }
+
+  /// Allocate own storage on numa node, or by allocator aligned to cache line
+  bool allocate_storage (const bool aligned);
 
   Tvalue* get_from_global_mempool (const size_t size)
   {
@@ -80,6 +123,34 @@ class iqalloc_cache
     return true;
   }
 
+  /// tail halves are read separately, torn value is rejected by swap_tail
+  queue_pos load_tail () const
+  {
+    queue_pos pos;
+#if defined (TS_HAS_LOCK_FREE_DWCAS)
+    pos.deep_counter = atomic_load_relaxed (& tail.deep_counter);
+    pos.index        = atomic_load_relaxed (& tail.index);
+#else
+    unsigned long packed = (unsigned long) atomic_load_relaxed (& tail);
+    pos.index        = (ts_word) (packed & TS_ALLOC_INDEX_MASK);
+    pos.deep_counter = (ts_word) (packed >> TS_ALLOC_INDEX_SIZE);
+#endif
+    return pos;
+  }
+
+  bool swap_tail (queue_pos& prev_tail, const queue_pos& new_tail)
+  {
+#if defined (TS_HAS_LOCK_FREE_DWCAS)
+    return atomic_compare_exchange_dw ( (volatile ts_dword*) & tail, * (const ts_dword*) & new_tail, * (ts_dword*) & prev_tail);
+#else
+    /// counter is wrapped by shift, it's enough against ABA
+    long prev_packed = (long) ( ( (unsigned long) prev_tail.deep_counter << TS_ALLOC_INDEX_SIZE) | (unsigned long) prev_tail.index);
+    long new_packed  = (long) ( ( (unsigned long) new_tail.deep_counter  << TS_ALLOC_INDEX_SIZE) | (unsigned long) new_tail.index);
+
+    return prev_packed == atomic_compare_exchange_acquire (& tail, new_packed, prev_packed);
+#endif
+  }
+
 public:
 
   void* operator new (size_t size)
@@ -88,17 +159,36 @@ public:
   void operator delete (void* p)
   { Tallocator allocator; allocator.deallocate (p); }
 
+  /** \param in_storage        - adopted storage of num_elem buffers, it isn't deallocated by cache
+    * \param in_aligned_blocks - own storage and buffers are aligned to cache line, neighbours don't share it
+    * \param in_numa_node      - own storage and free queue are placed on node, TS_ANY_NUMA_NODE is default */
    iqalloc_cache (const size_t in_buffer_size = 0x400,
                   const long num_elem       = TS_MAX_TRY_COUNTER,
                   const long in_try_counter = TS_MAX_TRY_COUNTER,
-                  const bool in_dont_use_global_mempool = false);
+                  const bool in_dont_use_global_mempool = false,
+                  Tvalue* in_storage = 0,
+                  const bool in_aligned_blocks = false,
+                  const long in_numa_node = TS_ANY_NUMA_NODE);
 
   ~iqalloc_cache ()
   {
-    if (ref_storage) aux_allocator.deallocate (ref_storage), ref_storage = 0;
-    if (storage)         allocator.deallocate     (storage),     storage = 0;
+    if (ref_storage && ref_numa_size) numa_deallocate (ref_storage, ref_numa_size);
+    else
+    if (ref_storage) aux_allocator.deallocate (ref_storage);
+
+    ref_storage = 0;
+
+    if (raw_storage && storage_numa_size) numa_deallocate (raw_storage, storage_numa_size);
+    else
+    if (raw_storage) allocator.deallocate (raw_storage);
+
+    storage = 0, raw_storage = 0;
   }
 
+  /// Numa node of storage, TS_ANY_NUMA_NODE if it isn't placed
+  long get_numa_node () const
+  { return storage_numa_size ? numa_node : TS_ANY_NUMA_NODE; }
+
   bool is_empty () const
   { return 0 == use_counter; }
 
@@ -116,7 +206,7 @@ public:
   }
 
   bool is_size_enough (const size_t size) const
-  { return buffer_size <= size; }
+  { return buffer_size >= size; }
 
   /** \param size is amount of symbols <Tvalue> in buffer */
   Tvalue* get (const size_t size = buffer_size);
@@ -127,43 +217,97 @@ public:
 template <class Tvalue, class Tallocator, class Taux_allocator>
 iqalloc_cache  <Tvalue,       Tallocator,       Taux_allocator>
 
-:: iqalloc_cache (const size_t in_buffer_size = 0x400,
-                  const long num_elem       = TS_MAX_TRY_COUNTER,
-                  const long in_try_counter = TS_MAX_TRY_COUNTER,
-                  const bool in_dont_use_global_mempool = false)
-                : head (0), buffer_size (in_buffer_size), max_elem (num_elem),
+:: iqalloc_cache (const size_t in_buffer_size,
+                  const long num_elem,
+                  const long in_try_counter,
+                  const bool in_dont_use_global_mempool,
+                  Tvalue* in_storage,
+                  const bool in_aligned_blocks,
+                  const long in_numa_node)
+                : ref_storage (0), storage (0), raw_storage (0), ref_numa_size (0), storage_numa_size (0),
                   dont_use_global_mempool (in_dont_use_global_mempool),
-                  use_counter (0), try_counter (in_try_counter)
+                  buffer_size (block_size (in_buffer_size, in_aligned_blocks && !in_storage) ),
+                  max_elem (num_elem), try_counter (in_try_counter), numa_node (in_numa_node),
+                  head (0), use_counter (0)
 {
-  if (max_elem >= TS_UNUSED_ALLOC_INDEX) { brk (); return; } ///< till it's limit of alloc cache
+#if !defined (TS_HAS_LOCK_FREE_DWCAS)
+  if ( (unsigned long) max_elem > TS_ALLOC_INDEX_MASK) { brk (); return; } ///< it's limit of packed tail on 32 bits targets only
+#endif
+
+  if (max_elem <= 0) { brk (); return; }
 
-  ref_storage = (qe*) aux_allocator.allocate (sizeof (*ref_storage) * max_elem);
+  if (numa_node >= 0
+   && 0 != (ref_storage = (qe*) numa_allocate (sizeof (*ref_storage) * max_elem, numa_node) ) )
+    ref_numa_size = sizeof (*ref_storage) * max_elem;
+  else
+    ref_storage = (qe*) aux_allocator.allocate (sizeof (*ref_storage) * max_elem);
 
   if (!ref_storage) { brk (); return; }
 
   memset (ref_storage, 0, sizeof (*ref_storage) * max_elem);
 
-  storage = (Tvalue*) allocator.allocate (sizeof (*storage) * buffer_size * max_elem);
+  if (in_storage)
+    storage = in_storage;
+  else
+  if (!allocate_storage (in_aligned_blocks) )
+  {
+    brk ();
+
+    if (ref_numa_size) numa_deallocate (ref_storage, ref_numa_size), ref_numa_size = 0;
+    else aux_allocator.deallocate (ref_storage);
 
-  if (!storage)
-  { brk (); aux_allocator.deallocate (ref_storage), ref_storage = 0; return; }
+    ref_storage = 0;
+    return;
+  }
 
   Tvalue* p = storage;
 
   for (long i = 0; i < max_elem; ++i, p += buffer_size)
   {
     ref_storage [i].buffer = p;
-    ref_storage [i].next.index = i + 1;
-    ref_storage [i].next.deep_counter = 0;
+    ref_storage [i].next = i + 1;
   }
 
   /// init ends
-  ref_storage [max_elem - 1].next.index = TS_UNUSED_ALLOC_INDEX;
+  ref_storage [max_elem - 1].next = TS_UNUSED_ALLOC_INDEX;
 
   head = & ref_storage [max_elem - 1];
 
+#if defined (TS_HAS_LOCK_FREE_DWCAS)
   tail.index = 0;
   tail.deep_counter = 0;
+#else
+  tail = 0;
+#endif
+}
+
+/// Allocate own storage on numa node, or by allocator aligned to cache line
+/** Numa storage is page aligned and bound to node by numa_allocate, or it's ordinary memory if binding fails */
+template <class Tvalue, class Tallocator, class Taux_allocator>
+bool iqalloc_cache <Tvalue,   Tallocator,       Taux_allocator>
+
+:: allocate_storage (const bool aligned)
+{
+  size_t size = sizeof (*storage) * buffer_size * max_elem;
+
+  if (numa_node >= 0
+   && 0 != (raw_storage = numa_allocate (size, numa_node) ) )
+  {
+    storage_numa_size = size;
+    storage = (Tvalue*) raw_storage;
+
+    memset (storage, 0, size); ///< pages are faulted in now, policy of storage places them on node
+    return true;
+  }
+
+  raw_storage = allocator.allocate (size + (aligned ? TS_CACHE_LINE_SIZE : 0) );
+
+  if (!raw_storage)
+    return false;
+
+  storage = aligned ? (Tvalue*) ( ( (size_t) raw_storage + TS_CACHE_LINE_SIZE - 1) & ~(size_t) (TS_CACHE_LINE_SIZE - 1) )
+                    : (Tvalue*) raw_storage;
+  return true;
 }
 
 /// get buffer
@@ -182,29 +326,30 @@ Tvalue* iqalloc_cache <Tvalue, Tallocator,       Taux_allocator>
   if (size > buffer_size)
     return get_from_global_mempool (size);
 
-  queue_pos prev_tail = tail;
-  register long tail_index = TS_UNUSED_ALLOC_INDEX;
+  queue_pos prev_tail = load_tail ();
+  long tail_index = TS_UNUSED_ALLOC_INDEX;
 
-  /// try to concurently get tail block
+  /// try to concurently get tail block, failed swap_tail reloads prev_tail
   long i = 0;
 
-  for (; i < try_counter; i++, prev_tail = tail)
+  for (; i < try_counter; i++)
   {
-    tail_index = prev_tail.index & TS_UNUSED_ALLOC_INDEX;
+    tail_index = (long) prev_tail.index;
 
-    if (tail_index == TS_UNUSED_ALLOC_INDEX
+    if (tail_index < 0
      || tail_index >= max_elem)
     {
       brk (); ///< tail already uses actual index
       return get_from_global_mempool (size);
     }
 
-    register long next_index = ref_storage [tail_index].next.index & TS_UNUSED_ALLOC_INDEX;
+    /// pairs with release store of revert, next block is completely linked
+    long next_index = atomic_load_acquire (& ref_storage [tail_index].next);
 
     if (next_index == TS_UNUSED_ALLOC_INDEX) /// empty head element detected
       return get_from_global_mempool (size);
 
-    if (next_index >= max_elem)
+    if (next_index < 0 || next_index >= max_elem)
     {
       brk (); ///< bad index detected
       return get_from_global_mempool (size);
@@ -218,12 +363,15 @@ Tvalue* iqalloc_cache <Tvalue, Tallocator,       Taux_allocator>
     /// init new tail
     queue_pos new_tail;
     new_tail.index = next_index;
-    new_tail.deep_counter = prev_tail.deep_counter + 1; ///< new_tail = next_index | ( (deep_counter + 1) << 0x10)
+    new_tail.deep_counter = prev_tail.deep_counter + 1;
 
     /// swap tail
-//    if ( ( (long) prev_tail) == atomic_compare_exchange ( (long*) & tail, (long) new_tail, (long) prev_tail) )
-    if (* ( (long*) (& prev_tail) ) == atomic_compare_exchange ( (long*) & tail, * ( (long*) (& new_tail) ), * ( (long*) (& prev_tail) ) ) )
+    if (swap_tail (prev_tail, new_tail) )
       break;
+
+#if !defined (TS_HAS_LOCK_FREE_DWCAS)
+    prev_tail = load_tail ();
+#endif
   }
 
   if (i >= try_counter)
@@ -238,9 +386,9 @@ Tvalue* iqalloc_cache <Tvalue, Tallocator,       Taux_allocator>
     return get_from_global_mempool (size);
   }
 
-  atomic_inc (& use_counter);
+  atomic_inc_relaxed (& use_counter);
 
-  ref_storage [tail_index].next.index = TS_UNUSED_ALLOC_INDEX; /// tail element freed from list
+  atomic_store_relaxed (& ref_storage [tail_index].next, TS_UNUSED_ALLOC_INDEX); /// tail element freed from list
 
   if (!ref_storage [tail_index].buffer) { brk (); /* ref_storage corrupted */ }
 
@@ -267,14 +415,14 @@ bool iqalloc_cache <Tvalue,   Tallocator,       Taux_allocator>
   /// prepare new head structure
   qe* pe = & ref_storage [index];
 
-  pe->next.index = TS_UNUSED_ALLOC_INDEX;
+  atomic_store_relaxed (& pe->next, TS_UNUSED_ALLOC_INDEX);
 
-  atomic_dec (& use_counter);
+  atomic_dec_relaxed (& use_counter);
 
   /// swap head structure pointer
-  pqe prev = (pqe) atomic_exchange ( (void**) & head, pe); ///< swap head
+  pqe prev = atomic_exchange_acq_rel (& head, pe); ///< swap head
 
-  prev->next.index = index;
+  atomic_store_release (& prev->next, (long) index); ///< link is published after block is reverted
 
   return true;
 }
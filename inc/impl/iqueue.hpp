@@ -84,6 +84,16 @@ public:
   /** \param[in] buffer is pointer to Tvalues
     * \return true if Tvalues get from pipe. */
   bool get (Tvalue* buffer);
+
+  /// Stores batch of Tvalues by one exchange of head.
+  /** \param[in] buffer is array of counter Tvalues
+    * \return number of Tvalues put into queue, it's less than counter if memory is over. */
+  long put_bulk (const Tvalue* buffer, const long counter);
+
+  /// Retrives up to counter Tvalues in one pass.
+  /** \param[in] buffer is array of counter Tvalues
+    * \return number of Tvalues get from queue. */
+  long get_bulk (Tvalue* buffer, const long counter);
 };
 
 /// Stores Tvalues.
@@ -146,7 +156,7 @@ bool iqueue    <Tvalue,       Tlocker,       Tallocator,       Talloc_cache>
   atomic_dec (& use_counter);
 
   if (prev_tail == (pqe) & next)
-    return false;    ///< skip first empty node
+    return true;     ///< first empty node isn't allocated from cache
 
   /// free temporary buffer
   if (palloc_cache)
@@ -157,6 +167,105 @@ bool iqueue    <Tvalue,       Tlocker,       Tallocator,       Talloc_cache>
   return true;
 }
 
+/// Stores batch of Tvalues by one exchange of head.
+/** Chain is linked privately, so readers see it at once after head exchange.
+  * \param[in] buffer is array of counter Tvalues
+  * \return number of Tvalues put into queue, it's less than counter if memory is over. */
+template <class Tvalue, class Tlocker, class Tallocator, class Talloc_cache>
+long iqueue    <Tvalue,       Tlocker,       Tallocator,       Talloc_cache>
+
+:: put_bulk (const Tvalue* buffer, const long counter)
+{
+  if (!buffer || counter <= 0) { brk (); return 0; }
+
+  pqe first = 0, last = 0;
+  long i = 0;
+
+  tstl :: allocator a;
+
+  for (; i < counter; i++)
+  {
+    /// get piece of memory
+    pqe pe = palloc_cache ? (pqe) palloc_cache->get  (sizeof (*pe) )
+                          : (pqe) allocator.allocate (sizeof (*pe) );
+    if (!pe)
+    { brk (); break; }
+
+    /// put value to temporary buffer
+    :: new ( (void*) & pe->value, a) Tvalue (buffer [i]);
+
+    pe->next = 0;
+
+    if (last)
+      last->next = pe, last = pe;
+    else
+      first = last = pe;
+  }
+
+  if (!i)
+    return 0;
+
+  atomic_add_return (& use_counter, i);
+
+  /// insert chain to head of list
+  pqe prev = (pqe) atomic_exchange ( (void**) & head, last); ///< swap head
+
+  prev->next = first;
+
+  return i;
+}
+
+/// Retrives up to counter Tvalues in one pass.
+/** \param[in] buffer is array of counter Tvalues
+  * \return number of Tvalues get from queue. */
+template <class Tvalue, class Tlocker, class Tallocator, class Talloc_cache>
+long iqueue    <Tvalue,       Tlocker,       Tallocator,       Talloc_cache>
+
+:: get_bulk (Tvalue* buffer, const long counter)
+{
+  if (!buffer || !tail || counter <= 0) { brk (); return 0; }
+
+  /// remove up to counter elements from tail of list
+  if (many_readers) tail_locker.lock ();
+
+  pqe prev_tail = tail;
+  long i = 0;
+
+  tstl :: allocator a;
+
+  for (; i < counter && tail->next; i++)
+  {
+    tail = tail->next; ///< swap tail
+
+    /// copy value from temporary buffer
+    :: new ( (void*) & buffer [i], a) Tvalue (tail->value);
+  }
+
+  if (many_readers) tail_locker.unlock ();
+
+  if (!i)
+    return 0;
+
+  atomic_add_return (& use_counter, -i);
+
+  /// free temporary buffers, they are linked up to new tail
+  for (long j = 0; j < i; j++)
+  {
+    pqe pe = prev_tail;
+    prev_tail = prev_tail->next;
+
+    if (pe == (pqe) & next)
+      continue;      ///< first empty node isn't allocated from cache
+
+    if (palloc_cache)
+      palloc_cache->revert ( (char*) pe), pe = 0;
+    else
+      allocator.deallocate ( (char*) pe), pe = 0;
+  }
+
+  return i;
+}
+
 }; /* end of tstl namespace */
 
 #endif /* __IQUEUE_HPP__ */
@@ -0,0 +1,373 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file magalloccache.hpp
+ *
+ *  Abstract:		\brief Per thread magazine layer of memory allocating cache.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: iqalloc_cache, melocker, spinlock :: mutex, thread_slot, allocator
+ *  Internal: magalloc_cache
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __MAGALLOCCACHE_HPP__
+#define __MAGALLOCCACHE_HPP__
+
+#include "impl/iqalloccache.hpp"
+#include "impl/melocker.hpp"
+#include "impl/tsthread.h"
+
+#define TS_MAGAZINE_SIZE  32
+#define TS_MAGAZINE_SLOTS 16
+
+namespace tstl {
+
+/// Magazine allocating cache (Bonwick's magazines over shared cache)
+/** Every thread slot keeps loaded and previous magazines of free blocks, so get and revert
+  * usually touch only own cache line. Full and empty magazines are exchanged with depot
+  * under Tlocker, blocks are taken from shared cache and given back to it in batches. */
+template <class Tvalue = char, class Tallocator = allocator, class Taux_allocator = Tallocator,
+          class Talloc_cache = iqalloc_cache <Tvalue, Tallocator, Taux_allocator>,
+          class Tlocker = melocker<>, long Tmagazine_size = TS_MAGAZINE_SIZE, long Tslots = TS_MAGAZINE_SLOTS>
+
+class magalloc_cache
+{
+  typedef struct magazine
+  {
+    magazine* next;                 ///< depot list link
+    long      rounds;               ///< number of free blocks
+    Tvalue*   round [Tmagazine_size];
+  } mag, *pmag;
+
+  typedef struct cpu_cache
+  {
+    spinlock :: mutex locker;
+    pmag loaded;                    ///< magazine for current get and revert
+    pmag previous;                  ///< it's full or empty always
+    long used;                      ///< slot statistic, could be negative when blocks move between slots
+    long misses;                    ///< accesses to shared cache
+    char pad [TS_CACHE_LINE_SIZE - sizeof (spinlock :: mutex) - 2 * sizeof (pmag) - 2 * sizeof (long)];
+  } cc, *pcc;
+
+  cc slots [Tslots];
+
+  Talloc_cache cache;               ///< shared cache of blocks
+
+  Tlocker depot_locker;
+  pmag depot_full;                  ///< full magazines
+  pmag depot_empty;                 ///< empty magazines
+
+  pmag magazines;                   ///< storage of magazines
+  long magazines_number;
+
+  const size_t buffer_size;
+  const bool dont_use_global_mempool; /// allocating behaviour
+
+  Taux_allocator aux_allocator;
+      Tallocator     allocator;
+
+  Tvalue* get_from_global_mempool (const size_t size)
+  {
+    if (dont_use_global_mempool)
+      return 0;
+
+    return (Tvalue*) allocator.allocate (sizeof (Tvalue) * size);
+  }
+
+  bool revert_to_global_mempool (Tvalue* buffer)
+  {
+    if (!buffer) { brk (); return false; }
+
+    if (dont_use_global_mempool)
+      return false;
+
+	allocator.deallocate ( (char*) buffer), buffer = 0;
+    return true;
+  }
+
+  pcc get_slot ()
+  { return & slots [thread_slot () % Tslots]; }
+
+  /// Take magazine from one depot list and give other magazine to another one
+  pmag depot_exchange (pmag* from, pmag* to, pmag pm)
+  {
+    depot_locker.lock ();
+
+    pmag taken = *from;
+
+    if (taken)
+    {
+      *from = taken->next;
+      pm->next = *to, *to = pm;
+    }
+
+    depot_locker.unlock ();
+
+    return taken;
+  }
+
+  /// Fill magazine by batch of blocks from shared cache
+  void fill (pmag pm)
+  {
+    for (long i = pm->rounds; i < Tmagazine_size / 2; i++)
+    {
+      Tvalue* buffer = cache.get (buffer_size);
+
+      if (!buffer)
+        break;
+
+      pm->round [pm->rounds++] = buffer;
+    }
+  }
+
+  /// Give all blocks of magazine back to shared cache
+  void drain (pmag pm)
+  {
+    while (pm->rounds > 0)
+      cache.revert (pm->round [--pm->rounds]);
+  }
+
+  Tvalue* pop (pcc pc);
+
+  void push (pcc pc, Tvalue* buffer);
+
+public:
+
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  /** \param in_storage is adopted storage of shared cache */
+   magalloc_cache (const size_t in_buffer_size = 0x400,
+                   const long num_elem       = TS_MAX_TRY_COUNTER,
+                   const long in_try_counter = TS_MAX_TRY_COUNTER,
+                   const bool in_dont_use_global_mempool = false,
+                   Tvalue* in_storage = 0);
+
+  ~magalloc_cache ()
+  {
+    if (!magazines) return;
+
+    for (long i = 0; i < magazines_number; i++)
+      drain (& magazines [i]);
+
+    aux_allocator.deallocate (magazines), magazines = 0;
+  }
+
+  bool is_empty () const
+  { return 0 == get_stat (); }
+
+  /// Get statistic about cache using
+  /** \param slot is thread slot, -1 means all slots */
+  long get_stat (long slot = -1) const
+  {
+    if (-1 != slot && slot < Tslots)
+      return slots [slot].used;
+
+    long used = 0;
+
+    for (long i = 0; i < Tslots; i++)
+      used += slots [i].used;
+
+    return used;
+  }
+
+  /// Get statistic about shared cache accesses
+  /** \param slot is thread slot, -1 means all slots */
+  long get_miss_stat (long slot = -1) const
+  {
+    if (-1 != slot && slot < Tslots)
+      return slots [slot].misses;
+
+    long misses = 0;
+
+    for (long i = 0; i < Tslots; i++)
+      misses += slots [i].misses;
+
+    return misses;
+  }
+
+  bool is_address_from_cache (Tvalue* buffer) const
+  { return cache.is_address_from_cache (buffer); }
+
+  bool is_size_enough (const size_t size) const
+  { return cache.is_size_enough (size); }
+
+  /** \param size is amount of symbols <Tvalue> in buffer */
+  Tvalue* get (const size_t size);
+
+  bool revert (Tvalue* buffer);
+};
+
+template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache,
+          class Tlocker, long Tmagazine_size, long Tslots>
+magalloc_cache <Tvalue, Tallocator, Taux_allocator, Talloc_cache, Tlocker, Tmagazine_size, Tslots>
+
+:: magalloc_cache (const size_t in_buffer_size,
+                   const long num_elem,
+                   const long in_try_counter,
+                   const bool in_dont_use_global_mempool,
+                   Tvalue* in_storage)
+                 : cache (in_buffer_size, num_elem, in_try_counter, true, in_storage),
+                   depot_full (0), depot_empty (0), magazines (0), magazines_number (0),
+                   buffer_size (in_buffer_size),
+                   dont_use_global_mempool (in_dont_use_global_mempool)
+{
+  memset (slots, 0, sizeof (slots) );
+
+  /// two magazines per slot and enough empty ones for all blocks of shared cache
+  magazines_number = 2 * Tslots + num_elem / Tmagazine_size + 1;
+
+  magazines = (pmag) aux_allocator.allocate (sizeof (*magazines) * magazines_number);
+
+  if (!magazines) { brk (); return; }
+
+  memset (magazines, 0, sizeof (*magazines) * magazines_number);
+
+  long i = 0;
+
+  for (; i < Tslots; i++)
+  {
+    slots [i].locker.init ();
+    slots [i].loaded   = & magazines [2 * i];
+    slots [i].previous = & magazines [2 * i + 1];
+  }
+
+  for (i = 2 * Tslots; i < magazines_number; i++)
+    magazines [i].next = depot_empty, depot_empty = & magazines [i];
+}
+
+/// Take block from magazines of slot, slot is locked
+template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache,
+          class Tlocker, long Tmagazine_size, long Tslots>
+Tvalue* magalloc_cache <Tvalue, Tallocator, Taux_allocator, Talloc_cache, Tlocker, Tmagazine_size, Tslots>
+
+:: pop (pcc pc)
+{
+  if (!pc->loaded->rounds)
+  {
+    pmag pm = 0;
+
+    if (pc->previous->rounds)
+    { ///< previous is full
+      pm = pc->previous, pc->previous = pc->loaded, pc->loaded = pm;
+    }
+    else if ( (pm = depot_exchange (& depot_full, & depot_empty, pc->previous) ) )
+    { ///< previous empty went to depot
+      pc->previous = pc->loaded, pc->loaded = pm;
+    }
+    else
+    {
+      pc->misses++;
+      fill (pc->loaded);
+    }
+  }
+
+  if (!pc->loaded->rounds)
+    return 0;
+
+  return pc->loaded->round [--pc->loaded->rounds];
+}
+
+/// Put block to magazines of slot, slot is locked
+template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache,
+          class Tlocker, long Tmagazine_size, long Tslots>
+void magalloc_cache <Tvalue, Tallocator, Taux_allocator, Talloc_cache, Tlocker, Tmagazine_size, Tslots>
+
+:: push (pcc pc, Tvalue* buffer)
+{
+  if (Tmagazine_size == pc->loaded->rounds)
+  {
+    pmag pm = 0;
+
+    if (!pc->previous->rounds)
+    { ///< previous is empty
+      pm = pc->previous, pc->previous = pc->loaded, pc->loaded = pm;
+    }
+    else if ( (pm = depot_exchange (& depot_empty, & depot_full, pc->previous) ) )
+    { ///< previous full went to depot
+      pc->previous = pc->loaded, pc->loaded = pm;
+    }
+    else
+    {
+      pc->misses++;
+      drain (pc->loaded);
+    }
+  }
+
+  pc->loaded->round [pc->loaded->rounds++] = buffer;
+}
+
+/// get buffer
+/** \param size is amount of symbols <Tvalue> in buffer */
+template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache,
+          class Tlocker, long Tmagazine_size, long Tslots>
+Tvalue* magalloc_cache <Tvalue, Tallocator, Taux_allocator, Talloc_cache, Tlocker, Tmagazine_size, Tslots>
+
+:: get (const size_t size)
+{
+  if (!size)
+  { brk (); return 0; }
+
+  if (!magazines || !buffer_size)
+  { brk (); return get_from_global_mempool (size); }
+
+  if (size > buffer_size)
+    return get_from_global_mempool (size);
+
+  pcc pc = get_slot ();
+
+  pc->locker.lock ();
+
+  Tvalue* buffer = pop (pc);
+
+  if (buffer)
+    pc->used++;
+
+  pc->locker.unlock ();
+
+  return buffer ? buffer : get_from_global_mempool (size);
+}
+
+template <class Tvalue, class Tallocator, class Taux_allocator, class Talloc_cache,
+          class Tlocker, long Tmagazine_size, long Tslots>
+bool magalloc_cache <Tvalue, Tallocator, Taux_allocator, Talloc_cache, Tlocker, Tmagazine_size, Tslots>
+
+:: revert (Tvalue* buffer)
+{
+  if (!buffer || !magazines)
+  { brk (); return false; }
+
+  if (!is_address_from_cache (buffer) )
+  {
+    if (dont_use_global_mempool)
+    { brk (); /* it's alien pointer */ }
+
+    revert_to_global_mempool (buffer);
+    return false;
+  }
+
+  pcc pc = get_slot ();
+
+  pc->locker.lock ();
+
+  push (pc, buffer);
+  pc->used--;
+
+  pc->locker.unlock ();
+
+  return true;
+}
+
+}; /* end of tstl namespace */
+
+#endif /* __MAGALLOCCACHE_HPP__ */
@@ -31,6 +31,8 @@ namespace tstl {
 template <class Tlocker = spinlock :: mutex>
 #elif defined (USE_FAST_MUTEX)
 template <class Tlocker = fastlock :: mutex>
+#elif defined (USE_FUTEX_MUTEX)
+template <class Tlocker = futexlock :: mutex>
 #else
 template <class Tlocker = mutex>
 #endif
@@ -10,7 +10,7 @@
  *
  *  Classes, methods and structures: \details
  *
- *  Internal: mutex, fastlock :: mutex, spinlock :: mutex, emptylock :: mutex
+ *  Internal: mutex, fastlock :: mutex, futexlock :: mutex, spinlock :: mutex, emptylock :: mutex
  *
  *  TODO:		\todo
  *
@@ -65,6 +65,29 @@ public:
 
 }; /* end of fastlock namespace */
 
+/// crossplatform waitable mutex. It bases on inerlocked CAS and parks waiters on locker (futex).
+namespace futexlock {
+
+class mutex
+{
+  ts_resource_wait_lock_define (locker);
+
+public:
+
+  void init ()
+  { ts_resource_wait_lock_init (locker); }
+
+  mutex () { init (); }
+
+  void lock ()
+  { ts_resource_wait_lock   (locker); }
+
+  void unlock ()
+  { ts_resource_wait_unlock (locker); }
+};
+
+}; /* end of futexlock namespace */
+
 /// Spin lock based mutex
 namespace spinlock {
 
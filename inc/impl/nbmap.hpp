@@ -10,8 +10,8 @@
  *
  *  Classes, methods and structures: \details
  *
- *  External:	hash_key, ts_sleep, allocator
- *  Internal:	multimap, enum_pos, mp (map_pos)
+ *  External:	hash_key, ts_sleep, allocator, wait_reclaim, epoch_reclaim
+ *  Internal:	multimap, enum_pos, mp (map_pos), value_store
  *
  *  TODO:		\todo
  *
@@ -23,14 +23,29 @@
 #include "tstl.hpp"
 
 #include "impl/tshash.hpp"
+#include "impl/tsepoch.hpp"
+
+#include <limits.h>
 
 namespace tstl {
 namespace nbmap {
 
 /// Map initial configuration
-#define NB_MAP_LEVEL_LENGTH	4
+#define NB_MAP_LEVEL_LENGTH	4 ///< default bits of hash per sub level, sub level has 1 << bits elements
 #define NB_MAP_HASH_LENGTH	(sizeof (Thash) << 3)
-#define NB_MAP_MAX_LEVELS	( (NB_MAP_HASH_LENGTH / NB_MAP_LEVEL_LENGTH) + 1)
+#define NB_MAP_MAX_LEVELS(L)	( (NB_MAP_HASH_LENGTH + (L) - 1) / (L) + 2)
+#define NB_MAP_GROUP_ELEMS	4 ///< elements of sparse sub level are allocated by groups on insert
+#define NB_MAP_INLINE_SIZE	(2 * sizeof (void*)) ///< plain values up to it are stored in map element
+
+/// Compact layout: status and reference counter in one word, hashes of level in own array
+#if defined (NB_MAP_COMPACT_LAYOUT) && ULONG_MAX <= 0xffffffffUL
+#  error NB_MAP_COMPACT_LAYOUT needs 64 bits long, status and reference counter do not fit one long
+#endif
+
+#if defined (NB_MAP_COMPACT_LAYOUT)
+#  define NB_MAP_STATUS_MASK	0xffffffffL                 ///< low half of state is status
+#  define NB_MAP_REF_ONE	(NB_MAP_STATUS_MASK + 1)    ///< high half of state is reference counter
+#endif
 
 /// Used on map enumerating
 typedef struct enum_pos
@@ -82,22 +97,98 @@ struct map_pos
 
 typedef map_pos<> mp, *pmp;
 
+/// Storing policy of map element value, value is allocated by map allocator
+template <class Tvalue, bool Tinline = (value_traits <Tvalue> :: is_pod && sizeof (Tvalue) <= NB_MAP_INLINE_SIZE)>
+
+struct value_store
+{
+  enum { is_inline = 0 };
+
+  template <class Tallocator> Tvalue* get_value_buffer (Tallocator& allocator)
+  { return (Tvalue*) allocator.allocate (sizeof (Tvalue) ); }
+
+  template <class Tallocator> void free_value_buffer (Tallocator& allocator, Tvalue* pval)
+  { allocator.deallocate (pval); }
+
+  /// Value isn't in element
+  const Tvalue* stored_value () const
+  { return 0; }
+};
+
+/// Small plain value is stored in map element, lookup doesn't go to other memory block.
+/** Value lives while element is LIVE, readers are protected by reference counter of element */
+template <class Tvalue>
+
+struct value_store <Tvalue, true>
+{
+  enum { is_inline = 1 };
+
+  ts_word value [(sizeof (Tvalue) + sizeof (ts_word) - 1) / sizeof (ts_word)];
+
+  template <class Tallocator> Tvalue* get_value_buffer (Tallocator& allocator)
+  { Tallocator& unused_allocator = allocator; return (Tvalue*) value; }
+
+  template <class Tallocator> void free_value_buffer (Tallocator& allocator, Tvalue* pval)
+  { Tallocator& unused_allocator = allocator; Tvalue* unused_pval = pval; }
+
+  /// Value in element, it's read without lock by versioned copy
+  const Tvalue* stored_value () const
+  { return (const Tvalue*) value; }
+};
+
 /// Object Status Graph (OSG)
 /** +---------------------LOOPBACK----------------------+
   * +-> FREE -> BUSY -> LIVE -> KILL +---->---+-> ERAS -+
   *                                  +-> DEAD +        */
-template <class Tkey, class Tvalue, class Thash = size_t, class Tallocator = allocator>
+/** Root level is array of elements indexed directly. Sub level made on collision has
+  * 1 << Tlevel_length elements, if they are more than NB_MAP_GROUP_ELEMS it keeps array of
+  * group pointers only and group of elements is installed by compare exchange on first insert
+  * into it. Elements are never moved, so locked element stays valid while sub level grows.
+  * Sub levels and groups are freed by destructor only.
+  * Treclaim is freeing policy of boxed values. With wait_reclaim remover waits for readers of
+  * element, with epoch_reclaim remover marks used element DEAD and goes on, last reader erases
+  * it on release and value is retired into epoch domain, so plain boxed values are copied by
+  * copy_by_key/copy_by_hash without reference too. */
+template <class Tkey, class Tvalue, class Thash = size_t, class Tallocator = allocator,
+          class Tstore = value_store <Tvalue>, long Tlevel_length = NB_MAP_LEVEL_LENGTH,
+          class Treclaim = wait_reclaim>
 
 class multimap
 {
-  typedef struct map_elem
+  /// empty boxed store takes no place by empty base
+#if defined (NB_MAP_COMPACT_LAYOUT)
+  typedef struct map_elem : Tstore
+  {
+    /// redanted service information
+    long  state;  ///< reference counter * NB_MAP_REF_ONE + status, both are changed by one exchange
+    long  version; ///< incremented on every BUSY -> LIVE
+
+    /// usefull payload
+    Tvalue*   pval; ///< value in store or allocated one
+    multimap* pmap; ///< Collision map
+    Tkey  key;
+  } me, *pme;
+
+  pme storage;
+  Thash* hashes;     ///< hashes of elements, probe compares them before element is touched
+  void* raw_storage; ///< hashes and storage are in it aligned to cache line
+
+  /// Elements of sparse sub level
+  typedef struct elem_group
+  {
+    Thash hashes [NB_MAP_GROUP_ELEMS];
+    me    elems  [NB_MAP_GROUP_ELEMS];
+  } eg, *peg;
+#else
+  typedef struct map_elem : Tstore
   {
     /// redanted service information
     long  status; ///< "FREE" || "BUSY" || "LIVE" || "KILL" || "DEAD" || "ERAS"
     long  ref;
+    long  version; ///< incremented on every BUSY -> LIVE
 
     /// usefull payload
-    Tvalue*   pval;
+    Tvalue*   pval; ///< value in store or allocated one
     multimap* pmap; ///< Collision map
     Thash hash;
     Tkey  key;
@@ -105,6 +196,15 @@ class multimap
 
   pme storage;
 
+  /// Elements of sparse sub level
+  typedef struct elem_group
+  {
+    me elems [NB_MAP_GROUP_ELEMS];
+  } eg, *peg;
+#endif
+
+  peg* groups; ///< groups of sparse sub level, storage is 0 then
+
   /// b-tree branch description
   typedef struct hash_part
   {
@@ -115,7 +215,7 @@ class multimap
   /// b-tree design template description
   typedef struct map_arch
   {
-    hash_part hp [NB_MAP_MAX_LEVELS];
+    hash_part hp [NB_MAP_MAX_LEVELS (Tlevel_length)];
     unsigned char levels; /// 0-based. levels = (real Levels - 1)
   } ma, *pma;
 
@@ -132,6 +232,79 @@ class multimap
 
   /// Maps private methods
 
+  /// Element by index, 0 if its group isn't installed yet
+  pme elem_at (const unsigned long elem) const
+  {
+    if (storage)
+      return & storage [elem];
+
+    peg pg = groups ? atomic_load_acquire (& groups [elem / NB_MAP_GROUP_ELEMS]) : 0;
+
+    return pg ? & pg->elems [elem % NB_MAP_GROUP_ELEMS] : 0;
+  }
+
+  /// Element by index, its group is installed if it isn't yet
+  pme install_elem (const unsigned long elem);
+
+  bool has_storage () const
+  { return level_elems && (storage || groups); }
+
+#if defined (NB_MAP_COMPACT_LAYOUT)
+  /// Reference counter of state
+  static long state_ref (const long state)
+  { return (state - (state & NB_MAP_STATUS_MASK) ) / NB_MAP_REF_ONE; }
+
+  /// Add delta to reference counter of element, status isn't changed
+  /** \return new reference counter */
+  long add_ref (pme& pelem, const long delta) const
+  { return state_ref (atomic_add_return (& pelem->state, delta * NB_MAP_REF_ONE) + delta * NB_MAP_REF_ONE); }
+
+  long get_status (const pme pelem) const
+  { return atomic_load_acquire (& pelem->state) & NB_MAP_STATUS_MASK; }
+
+  long get_ref (const pme pelem) const
+  { return state_ref (atomic_load_acquire (& pelem->state) ); }
+
+  Thash& elem_hash (const unsigned long elem) const
+  {
+    if (storage)
+      return hashes [elem];
+
+    return groups [elem / NB_MAP_GROUP_ELEMS]->hashes [elem % NB_MAP_GROUP_ELEMS];
+  }
+
+  /// Hash isn't cleared, it's compared for LIVE element only
+  void clear_elem (pme pelem) const
+  { pelem->key = 0; }
+
+  /// FREE status and null reference counter
+  void reset_state (pme pelem) const
+  { pelem->state = TS_FREE_SIGN; }
+
+  /// Lock reference on element
+  long lock (pme& pelem) const
+  { return add_ref (pelem, 1); }
+
+  /// Free reference on element
+  long release (pme& pelem) const
+  { return add_ref (pelem, -1); }
+#else
+  long get_status (const pme pelem) const
+  { return atomic_load_acquire (& pelem->status); }
+
+  long get_ref (const pme pelem) const
+  { return pelem->ref; }
+
+  Thash& elem_hash (const unsigned long elem) const
+  { return elem_at (elem)->hash; }
+
+  void clear_elem (pme pelem) const
+  { pelem->hash = 0, pelem->key = 0; }
+
+  /// FREE status and null reference counter
+  void reset_state (pme pelem) const
+  { pelem->ref = 0, pelem->status = TS_FREE_SIGN; }
+
   /// Lock reference on element
   long lock (pme& pelem) const
   { return atomic_inc_return (& pelem->ref); }
@@ -139,11 +312,21 @@ class multimap
   /// Free reference on element
   long release (pme& pelem) const
   { return atomic_dec_return (& pelem->ref); }
+#endif
 
   /// Synoname of release
   long unlock (pme& pelem) const
   { return release (pelem); }
 
+#if defined (NB_MAP_COMPACT_LAYOUT)
+  /// Lock reference counter removed element
+  long lock_remove (pme& pelem) const
+  { return add_ref (pelem, TS_MINUS_NULL); }
+
+  /// Free reference counter removed element
+  void release_remove (pme& pelem) const
+  { add_ref (pelem, TS_MINUS_MEDIAN); }
+#else
   /// Lock reference counter removed element
   long lock_remove (pme& pelem) const
   { return (atomic_add_return (& pelem->ref, TS_MINUS_NULL) + TS_MINUS_NULL); }
@@ -151,14 +334,53 @@ class multimap
   /// Free reference counter removed element
   void release_remove (pme& pelem) const
   { atomic_add_return (& pelem->ref, TS_MINUS_MEDIAN); }
+#endif
 
   /// Synoname of release_remove
   void unlock_remove (pme& pelem) const
   { release_remove (pelem); }
 
   /// Change status of map element from XXX -> (to) YYY
+#if defined (NB_MAP_COMPACT_LAYOUT)
+  /** Exchange is repeated while only reference counter is changed */
+  long change_status (pme& pelem, long new_status, long previos_status) const
+  {
+    for (;;)
+    {
+      long state  = atomic_load_relaxed (& pelem->state);
+      long status = state & NB_MAP_STATUS_MASK;
+
+      if (status != previos_status)
+        return status;
+
+      if (state == atomic_compare_exchange (& pelem->state, state - status + new_status, state) )
+        return status;
+    }
+  }
+#else
   long change_status (pme& pelem, long new_status, long previos_status) const
   { return atomic_compare_exchange (& pelem->status, new_status, previos_status); }
+#endif
+
+  /// Destroy and free boxed value, it's called by epoch domain after readers leave
+  static void free_boxed_value (void* pointer, void* context)
+  {
+    void* unused_context = context;
+    Tallocator allocator;
+
+    ( (Tvalue*) pointer)-> ~Tvalue ();
+    allocator.deallocate (pointer);
+  }
+
+  /// Destroy and free value of element, deferred policy retires boxed value
+  void free_value (pme pelem, Tvalue* pval)
+  {
+    if (Treclaim :: is_deferred && !Tstore :: is_inline)
+    { Treclaim :: retire (pval, free_boxed_value); return; }
+
+    pval-> ~Tvalue ();
+    pelem->free_value_buffer (allocator, pval);
+  }
 
   /// Cleanup element
   bool remove_dead (pme pelem);
@@ -174,7 +396,7 @@ class multimap
 
   /// LIVE -> KILL (-> ERAS -> FREE) || LIVE -> KILL -> DEAD
   /** Set status FREE or DEAD, begin with LIVE status going over KILL and ERAS
-    * \return false if pelem biger of TopStorage */
+    * \return false if pelem is 0 */
   bool remove (pme pelem);
 
   /// Doesn't thread safe method, it called from destructor
@@ -183,6 +405,32 @@ class multimap
   /// Check and lock LIVE element else go down in to lower map
   bool look_for_live_elem (mp& pos, Tkey& key, Thash& hash, Tvalue*& pvalue);
 
+  /// Copy value of element without lock
+  /** \return 1 if value is copied, 0 if element hasn't key, -1 if element was changed while copying */
+  long read_elem (const pme pelem, const unsigned long elem, const Tkey& key, const Thash& hash,
+                  const bool by_key, Tvalue* buffer) const;
+
+  /// Copy value by key or hash, element isn't written
+  bool copy_value (Tkey key, Thash hash, const bool by_key, Tvalue* buffer);
+
+  /// Copy value by versioned reads of elements
+  bool copy_unlocked (Tkey key, Thash hash, const bool by_key, Tvalue* buffer);
+
+  /// Copy value by key or hash under reference of element
+  bool copy_locked (Tkey key, Thash hash, const bool by_key, Tvalue* buffer)
+  {
+    mp pos;
+    Tvalue* pvalue = 0;
+
+    if (!(by_key ? search_by_key (pos, key, hash, pvalue) : search_by_hash (pos, hash, pvalue) ) )
+      return false;
+
+    *buffer = *pvalue;
+
+    release (pos);
+    return true;
+  }
+
   /// Get element index in map by key hash
   unsigned long get_elem (const Thash& hash) const
   {
@@ -221,7 +469,10 @@ public:
   multimap (const unsigned long root_array_elems = 32);
 
   /// Sub map initilize
-  multimap (const unsigned char in_level, const pma in_pmap_arch) : storage (0), use_counter (0), level_elems (0), level (1)
+  multimap (const unsigned char in_level, const pma in_pmap_arch) : storage (0), groups (0), use_counter (0), level_elems (0), level (1)
+#if defined (NB_MAP_COMPACT_LAYOUT)
+                                                                   , hashes (0), raw_storage (0)
+#endif
   {
     if (!in_pmap_arch || !in_level || in_level > in_pmap_arch->levels)
     { brk (); return; }
@@ -236,7 +487,20 @@ public:
   {
     remove_all_unsafe ();
 
+#if defined (NB_MAP_COMPACT_LAYOUT)
+    if (raw_storage) allocator.deallocate (raw_storage), raw_storage = 0;
+    storage = 0, hashes = 0;
+#else
     if (storage) allocator.deallocate (storage), storage = 0;
+#endif
+    if (groups)
+    {
+      for (unsigned long i = 0; i < (level_elems + NB_MAP_GROUP_ELEMS - 1) / NB_MAP_GROUP_ELEMS; i++)
+        if (groups [i]) allocator.deallocate (groups [i]), groups [i] = 0;
+
+      allocator.deallocate (groups), groups = 0;
+    }
+
     if (!level && pmap_arch) allocator.deallocate (pmap_arch), pmap_arch = 0;
   }
 
@@ -251,10 +515,11 @@ public:
   /// Get statistic about using map element
   long get_stat (Thash map_elem) const
   {
-    if (!storage || !level_elems)
+    if (!has_storage () )
     { brk (); return 0; }
 
-    return storage [map_elem % level_elems].ref;
+    pme pelem = elem_at ( (unsigned long) (map_elem % level_elems) );
+    return pelem ? get_ref (pelem) : 0;
   }
 
   /// Get hash by key
@@ -286,6 +551,17 @@ public:
   bool lookup_by_hash (mp& pos, Thash hash, Tvalue*& pvalue)
   { return search_by_hash (pos, hash, pvalue); }
 
+  /// Copy value found by key, map element isn't locked and isn't written
+  /** Value stored in element is copied optimisticaly and copy is checked by version of
+    * element, boxed value is copied under reference of element.
+    * \return true if value is copied */
+  bool copy_by_key (Tkey key, Tvalue* buffer)
+  { return copy_value (key, hk.hash (key), true, buffer); }
+
+  /// Copy value found by hash, map element isn't locked and isn't written
+  bool copy_by_hash (Thash hash, Tvalue* buffer)
+  { Tkey unused_key = Tkey (); return copy_value (unused_key, hash, false, buffer); }
+
   /// Look for element in map by position
   Tvalue* lookup (mp& pos);
 
@@ -311,6 +587,7 @@ public:
   /// Remove element from map by hash
   bool remove_by_hash (Thash hash);
 
+  /// Remove all elements, sub maps stay empty till destructor for readers without reference
   void remove_all ();
 
   /// Next maps enumerating & if failure than unlock last element
@@ -321,8 +598,10 @@ public:
 
   multimap* get_next_map (Thash& hash)
   {
-    if (!storage) { brk (); return 0; }
-    return storage [get_elem (hash) ].pmap;
+    if (!has_storage () ) { brk (); return 0; }
+
+    pme pelem = elem_at (get_elem (hash) );
+    return pelem ? pelem->pmap : 0;
   }
 
   /// Begin maps enumerating by hash & if successfull than lock element
@@ -334,8 +613,9 @@ public:
 };
 
 /// Cleanup element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: remove_dead (pme pelem)
 {
@@ -343,29 +623,24 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 
   if (!pelem->pval) ///< BUSY && ERAS may be
   {
-    pelem->ref  = 0;
-    pelem->hash = 0;
-    pelem->key  = 0;
-    pelem->status = TS_FREE_SIGN;
+    clear_elem (pelem);
+    reset_state (pelem);
     return false;
   }
 
-  pelem->pval-> ~Tvalue ();
+  free_value (pelem, pelem->pval), pelem->pval = 0;
 
-  allocator.deallocate (pelem->pval), pelem->pval = 0;
-
-  pelem->ref  = 0;
-  pelem->hash = 0;
-  pelem->key  = 0;
-  pelem->status = TS_FREE_SIGN;
+  clear_elem (pelem);
+  reset_state (pelem);
 
   atomic_dec (& use_counter);
   return true;
 }
 
 /// ERAS -> FREE. Enable only in ERASE status. If successfull than setup FREE status
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: erase (pme& pelem)
 {
@@ -375,17 +650,14 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
   if (locp
    && locp == prev)
   {
-    pelem->hash = 0;
-    pelem->key  = 0;
+    clear_elem (pelem);
 
     atomic_dec (& use_counter);
 
     if (locp)
     {
       ///< delete pval
-      locp-> ~Tvalue ();
-
-      allocator.deallocate (locp), locp = 0;
+      free_value (pelem, locp), locp = 0;
     }
 
     /// Set FREE status
@@ -402,8 +674,9 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 }
 
 /// DEAD -> ERAS -> FREE. Return true if erase dead element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: erase_dead (pme& pelem)
 {
@@ -413,7 +686,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
   if (TS_DEAD_SIGN == status)
   {
     /// Setup ERASE status successfull
-    if (pelem->ref == TS_MINUS_NULL)
+    if (get_ref (pelem) == TS_MINUS_NULL)
     {
       /// Reference counter locked successfull
       /** Begin termination dead element of map */
@@ -436,8 +709,9 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 }
 
 /// KILL -> ERAS -> FREE. Return true if erase element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: erase_killed (pme& pelem)
 {
@@ -460,13 +734,14 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 
 /// LIVE -> KILL (-> ERAS -> FREE) || LIVE -> KILL -> DEAD
 /** Set status FREE or DEAD, begin with LIVE status going over KILL and ERAS
-  * \return false if pelem biger of TopStorage */
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+  * \return false if pelem is 0 */
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: remove (pme pelem)
 {
-  if (pelem >= storage + level_elems) { brk (); return false; }
+  if (!pelem) { brk (); return false; }
 
   /// If LIVE status passed, than entry to killing status
   long status = change_status (pelem, TS_KILL_SIGN, TS_LIVE_SIGN);
@@ -533,12 +808,22 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
     }
   }
 
+  if (Treclaim :: is_deferred) ///< remover doesn't wait, last reader erases element on release
+  {
+    change_status (pelem, TS_DEAD_SIGN, TS_KILL_SIGN);
+
+    if (erase_dead (pelem) ) ///< readers left before element was marked
+      release_remove (pelem);
+
+    return true;
+  }
+
   /// Map element's in using, try to wait releasing
   long retry = TS_SPINLOCK_COUNTER;
 
   for (; retry > 0; retry--)
   {
-    if (pelem->ref == TS_MINUS_NULL)
+    if (get_ref (pelem) == TS_MINUS_NULL)
       break;
 
     ts_sleep (TS_SPINLOCK_SLEEP_TIME);
@@ -564,8 +849,9 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
   return false;
 }
 
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-unsigned long multimap <Tkey,   Tvalue,   Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+unsigned long multimap <Tkey,   Tvalue,   Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: get_max_boolean_divider (unsigned long dividend)
 {
@@ -582,17 +868,45 @@ unsigned long multimap <Tkey,   Tvalue,   Thash,       Tallocator>
   return max_divider;
 }
 
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: map_init ()
 {
   level_elems = (unsigned long) 1 << num_bits (pmap_arch->hp [level].mask);
 
+  /// Sparse sub level, groups are installed on insert
+  if (level && level_elems > NB_MAP_GROUP_ELEMS)
+  {
+    size_t groups_size = sizeof (*groups) * ( (level_elems + NB_MAP_GROUP_ELEMS - 1) / NB_MAP_GROUP_ELEMS);
+
+    groups = (peg*) allocator.allocate (groups_size);
+
+    if (!groups) { brk(); return false; }
+
+    memset (groups, 0, groups_size);
+    return true;
+  }
+
+#if defined (NB_MAP_COMPACT_LAYOUT)
+  /// Hashes and elements of level start on own cache lines
+  size_t hashes_size = (sizeof (*hashes) * level_elems + TS_CACHE_LINE_SIZE - 1) & ~(size_t) (TS_CACHE_LINE_SIZE - 1);
+
+  raw_storage = allocator.allocate (hashes_size + sizeof (*storage) * level_elems + TS_CACHE_LINE_SIZE);
+
+  if (!raw_storage) { brk(); return false; }
+
+  hashes  = (Thash*) ( ( (size_t) raw_storage + TS_CACHE_LINE_SIZE - 1) & ~(size_t) (TS_CACHE_LINE_SIZE - 1) );
+  storage = (me*) ( (char*) hashes + hashes_size);
+
+  memset (hashes, 0, hashes_size);
+#else
   /// Use level_elems
   storage = (me*) allocator.allocate (sizeof (*storage) * level_elems);
 
   if (!storage) { brk(); return false; }
+#endif
 
   memset (storage, 0, sizeof (me) * level_elems);
 
@@ -600,17 +914,21 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 
   /// Initialize map elements
   for (unsigned long i = 0; i < level_elems; i++, p++)
-    p->status = TS_FREE_SIGN;
+    reset_state (p);
 
   return true;
 }
 
 /// Root map initilise
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-multimap       <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+multimap       <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: multimap (const unsigned long root_array_elems = 32)
- : storage (0), use_counter (0), level_elems (0), level (0)
+ : storage (0), groups (0), use_counter (0), level_elems (0), level (0)
+#if defined (NB_MAP_COMPACT_LAYOUT)
+ , hashes (0), raw_storage (0)
+#endif
 {
   if (!root_array_elems) { brk (); return; }
 
@@ -632,17 +950,17 @@ multimap       <Tkey,       Tvalue,       Thash,       Tallocator>
 
   while (last)
   {
-    if (++(pmap_arch->levels) >= (unsigned char)(NB_MAP_MAX_LEVELS - 1) )
+    if (++(pmap_arch->levels) >= (unsigned char)(NB_MAP_MAX_LEVELS (Tlevel_length) - 1) )
     {
       brk ();
-      pmap_arch->levels = (unsigned char)(NB_MAP_MAX_LEVELS - 1);
+      pmap_arch->levels = (unsigned char)(NB_MAP_MAX_LEVELS (Tlevel_length) - 1);
       return;
     }
 
     /// previous level size plus previous offset
     pmap_arch->hp [pmap_arch->levels].off = pmap_arch->hp [pmap_arch->levels - 1].off + size;
 
-    size = last > NB_MAP_LEVEL_LENGTH ? NB_MAP_LEVEL_LENGTH : last;
+    size = last > Tlevel_length ? (unsigned char) Tlevel_length : last;
 
     pmap_arch->hp [pmap_arch->levels].mask = get_mask (size);
     last -= size;
@@ -651,6 +969,35 @@ multimap       <Tkey,       Tvalue,       Thash,       Tallocator>
   map_init ();
 }
 
+/// Element by index, its group is installed if it isn't yet
+/** Group is made by inserting thread, loser of install race frees own group */
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+typename multimap <Tkey, Tvalue, Thash, Tallocator, Tstore, Tlevel_length, Treclaim> :: pme
+multimap       <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
+
+:: install_elem (const unsigned long elem)
+{
+  pme pelem = elem_at (elem);
+
+  if (pelem)
+    return pelem;
+
+  peg pg = (peg) allocator.allocate (sizeof (*pg) );
+
+  if (!pg) { brk (); return 0; }
+
+  memset (pg, 0, sizeof (*pg) );
+
+  for (long i = 0; i < NB_MAP_GROUP_ELEMS; i++)
+    reset_state (& pg->elems [i]);
+
+  if (atomic_compare_exchange ( (void**) & groups [elem / NB_MAP_GROUP_ELEMS], pg, 0) )
+    allocator.deallocate (pg), pg = 0; ///< other thread installed group first
+
+  return elem_at (elem);
+}
+
 #define TS_GO_DOWN_RET(METHOD)	\
   if (pelem->pmap)		\
     return pelem->pmap->METHOD;	\
@@ -658,19 +1005,23 @@ multimap       <Tkey,       Tvalue,       Thash,       Tallocator>
     return false;
 
 /// Search array element by key & lock it
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: search_by_key (mp& pos, Tkey key, Thash hash, Tvalue*& pvalue)
 {
-  if (!storage || !level_elems)
+  if (!has_storage () )
   { brk (); return false; }
 
   pos.map   = this;
   pos.elem  = get_elem (hash);
-  pme pelem = & storage [pos.elem];
+  pme pelem = elem_at (pos.elem);
 
-  if (TS_LIVE_SIGN != pelem->status)
+  if (!pelem) ///< group isn't installed, element and its sub map are empty
+    return false;
+
+  if (TS_LIVE_SIGN != get_status (pelem))
   {
     if (erase_dead (pelem))
     {
@@ -683,6 +1034,12 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
     TS_GO_DOWN_RET (search_by_key (pos, key, hash, pvalue) );
   }
 
+  /// Element of other hash isn't locked, its reference counter line isn't written
+  if (elem_hash (pos.elem) != hash)
+  {
+    TS_GO_DOWN_RET (search_by_key (pos, key, hash, pvalue) );
+  }
+
   /// Lock element
   if (lock (pelem) <= 0)
   {
@@ -692,7 +1049,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
     TS_GO_DOWN_RET (search_by_key (pos, key, hash, pvalue) );
   }
 
-  if (TS_LIVE_SIGN != pelem->status)
+  if (TS_LIVE_SIGN != get_status (pelem))
   {
     unlock (pelem);
 
@@ -713,19 +1070,23 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 }
 
 /// Search array element by hash & lock it
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: search_by_hash (mp& pos, Thash hash, Tvalue*& pvalue)
 {
-  if (!storage || !level_elems)
+  if (!has_storage () )
   { brk (); return false; }
 
   pos.map   = this;
   pos.elem  = get_elem (hash);
-  pme pelem = & storage [pos.elem];
+  pme pelem = elem_at (pos.elem);
 
-  if (TS_LIVE_SIGN != pelem->status)
+  if (!pelem) ///< group isn't installed, element and its sub map are empty
+    return false;
+
+  if (TS_LIVE_SIGN != get_status (pelem))
   {
     if (erase_dead (pelem))
     {
@@ -738,6 +1099,12 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
     TS_GO_DOWN_RET (search_by_hash (pos, hash, pvalue) );
   }
 
+  /// Element of other hash isn't locked, its reference counter line isn't written
+  if (elem_hash (pos.elem) != hash)
+  {
+    TS_GO_DOWN_RET (search_by_hash (pos, hash, pvalue) );
+  }
+
   /// Lock element
   if (lock (pelem) <= 0)
   {
@@ -747,7 +1114,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
     TS_GO_DOWN_RET (search_by_hash (pos, hash, pvalue) );
   }
 
-  if (TS_LIVE_SIGN != pelem->status)
+  if (TS_LIVE_SIGN != get_status (pelem))
   {
     unlock (pelem);
 
@@ -755,7 +1122,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
   }
 
   /// Element successfully locked
-  if (pelem->hash == hash)
+  if (elem_hash (pos.elem) == hash)
   {
     pvalue = pelem->pval;
     return true;
@@ -768,23 +1135,27 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 }
 
 /// Insert element in map & if successfull than lock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: set_at (mp& pos, Tkey key, Thash hash, const Tvalue* pvalue)
 {
-  if (!storage || !level_elems)
+  if (!has_storage () )
   { brk (); return false; }
 
   pos.map   = this;
   pos.elem  = get_elem (hash);
-  pme pelem = & storage [pos.elem];
+  pme pelem = install_elem (pos.elem);
+
+  if (!pelem)
+  { brk (); return false; }
 
   long status = TS_BUSY_SIGN, retry = TS_SPINLOCK_COUNTER;
 
   for (; retry > 0; retry--)
   {
-    if (TS_FREE_SIGN != pelem->status)
+    if (TS_FREE_SIGN != get_status (pelem))
     {
       if (erase_dead (pelem) )
       {
@@ -813,7 +1184,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 	break;
       }
       else /// Collision detected
-      if (TS_FREE_SIGN != pelem->status)
+      if (TS_FREE_SIGN != get_status (pelem))
       {
 	if (level == pmap_arch->levels)
 	{ brk (); continue; }
@@ -888,8 +1259,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
     return false;
   }
 
-  /// Allocate new map value
-  Tvalue* pval = (Tvalue*) allocator.allocate (sizeof (*pval) );
+  /// Allocate new map value or take store of element
+  Tvalue* pval = pelem->get_value_buffer (allocator);
 
   if (!pval)
   {
@@ -905,20 +1276,124 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
   :: new ( (void*) pval, a) Tvalue (*pvalue);
 
   pelem->key  = key;
-  pelem->hash = hash;
+  elem_hash (pos.elem) = hash;
 
   /// Activate record
   pelem->pval = pval;
 
+  /// Lock free readers see new version with LIVE status
+  atomic_store_release (& pelem->version, pelem->version + 1);
+
   change_status (pelem, TS_LIVE_SIGN, TS_BUSY_SIGN);
 
   atomic_inc (& use_counter);
   return true;
 }
 
+/// Copy value stored in element without lock
+/** Key, hash and value are written while element isn't LIVE only, version is incremented
+  * before every LIVE status. Copy is valid if element was LIVE with same version before and
+  * after copying.
+  * \return 1 if value is copied, 0 if element hasn't key, -1 if element was changed while copying */
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+long multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
+
+:: read_elem (const pme pelem, const unsigned long elem, const Tkey& key, const Thash& hash,
+              const bool by_key, Tvalue* buffer) const
+{
+  long version = atomic_load_acquire (& pelem->version);
+
+  if (TS_LIVE_SIGN != get_status (pelem) )
+    return 0;
+
+  if (elem_hash (elem) != hash)
+    return 0;
+
+  /// boxed value is read in epoch of deferred policy, it isn't freed till reader leaves
+  const Tvalue* pvalue = Tstore :: is_inline ? pelem->stored_value () : atomic_load_acquire (& pelem->pval);
+
+  if (!pvalue) ///< element is erased
+    return -1;
+
+  Tkey   elem_key = pelem->key;
+  Tvalue value    = *pvalue;
+
+  atomic_fence_acquire (); ///< copy is read before status is checked again
+
+  if (TS_LIVE_SIGN != get_status (pelem)
+   || version != atomic_load_relaxed (& pelem->version) )
+    return -1;
+
+  if (by_key && elem_key != key)
+    return 0;
+
+  *buffer = value;
+  return 1;
+}
+
+/// Copy value by key or hash, element isn't written
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
+
+:: copy_value (Tkey key, Thash hash, const bool by_key, Tvalue* buffer)
+{
+  if (!buffer) { brk (); return false; }
+
+  if (Tstore :: is_inline)
+    return copy_unlocked (key, hash, by_key, buffer);
+
+  /// boxed value could be freed by remover, plain one is read without reference in epoch only
+  if (!Treclaim :: is_deferred || !value_traits <Tvalue> :: is_pod || !Treclaim :: enter () )
+    return copy_locked (key, hash, by_key, buffer);
+
+  bool copied = copy_unlocked (key, hash, by_key, buffer);
+
+  Treclaim :: leave ();
+  return copied;
+}
+
+/// Copy value by versioned reads of elements
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
+
+:: copy_unlocked (Tkey key, Thash hash, const bool by_key, Tvalue* buffer)
+{
+  /// Sub maps and groups are freed by destructor only (remove_all keeps them), so elements are read without lock
+  for (multimap* map = this; map; )
+  {
+    if (!map->has_storage () )
+    { brk (); return false; }
+
+    unsigned long elem = map->get_elem (hash);
+    pme pelem = map->elem_at (elem);
+
+    if (!pelem) ///< group isn't installed, element and its sub map are empty
+      return false;
+
+    long result = -1, retry = TS_SPINLOCK_COUNTER;
+
+    for (; retry > 0 && -1 == result; retry--)
+      result = map->read_elem (pelem, elem, key, hash, by_key, buffer);
+
+    if (1 == result)
+      return true;
+
+    if (-1 == result) ///< element is changed all the time, it's copied under reference
+      return map->copy_locked (key, hash, by_key, buffer);
+
+    map = atomic_load_acquire (& pelem->pmap);
+  }
+
+  return false;
+}
+
 /// Look for element in map by position
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-Tvalue* multimap <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+Tvalue* multimap <Tkey,     Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: lookup (mp& pos)
 {
@@ -927,16 +1402,17 @@ Tvalue* multimap <Tkey,     Tvalue,       Thash,       Tallocator>
   if (this != (multimap*) pos.map)
     return ( (multimap*) pos.map)->lookup (pos);
 
-  if (!( (multimap*) pos.map)->storage
-   || pos.elem >= ( (multimap*) pos.map)->level_elems)
-  { brk (); return 0; }
+  pme pelem = pos.elem < level_elems ? elem_at (pos.elem) : 0;
+
+  if (!pelem) { brk (); return 0; }
 
-  return ( (multimap*) pos.map)->storage [pos.elem].pval;
+  return pelem->pval;
 }
 
 /// Unlock position in map
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-void multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+void multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: release (mp& pos)
 {
@@ -948,17 +1424,19 @@ void multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
     return;
   }
 
-  if (!( (multimap*) pos.map)->storage
-   || pos.elem >= ( (multimap*) pos.map)->level_elems)
-  { brk (); return; }
+  pme pelem = pos.elem < level_elems ? elem_at (pos.elem) : 0;
+
+  if (!pelem) { brk (); return; }
 
-  pme pelem = & ( (multimap*) pos.map)->storage [pos.elem];
-  release (pelem);
+  if (TS_MINUS_NULL == release (pelem) ///< last reader of element which is marked DEAD by remover
+   && erase_dead (pelem) )
+    release_remove (pelem);
 }
 
 /// Remove element from map and always unlock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: remove (mp& pos)
 {
@@ -967,16 +1445,17 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
   if (this != (multimap*) pos.map)
     return ( (multimap*) pos.map)->remove (pos);
 
-  if (!( (multimap*) pos.map)->storage
-    || pos.elem >= ( (multimap*) pos.map)->level_elems)
-  { brk (); return false; }
+  pme pelem = pos.elem < level_elems ? elem_at (pos.elem) : 0;
 
-  return remove ( & ( (multimap*) pos.map)->storage [pos.elem]);
+  if (!pelem) { brk (); return false; }
+
+  return remove (pelem);
 }
 
 /// Remove element from map on cleanup
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: remove_dead (mp& pos)
 {
@@ -985,16 +1464,17 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
   if (this != (multimap*) pos.map)
     return ( (multimap*) pos.map)->remove_dead (pos);
 
-  if (!( (multimap*) pos.map)->storage
-    || pos.elem >= ( (multimap*) pos.map)->level_elems)
-  { brk (); return false; }
+  pme pelem = pos.elem < level_elems ? elem_at (pos.elem) : 0;
+
+  if (!pelem) { brk (); return false; }
 
-  return remove_dead (& ( (multimap*) pos.map)->storage [pos.elem]);
+  return remove_dead (pelem);
 }
 
 /// Remove element from map by key
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: remove_by_key (Tkey key)
 {
@@ -1008,8 +1488,9 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 }
 
 /// Remove element from map by keys hash
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: remove_by_key_hash (Tkey key)
 {
@@ -1023,8 +1504,9 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 }
 
 /// Remove element from map by hash
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: remove_by_hash (Thash hash)
 {
@@ -1038,19 +1520,23 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 }
 
 /// Doesn't thread safe method, it called from destructor
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-void multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+void multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: remove_all_unsafe ()
 {
-  if (!storage || !level_elems)
+  if (!has_storage () )
   { brk (); return; }
 
-  pme top_storage = storage + level_elems;
-
   /// Move to ahead of map array
-  for (pme pelem = storage; pelem < top_storage; pelem++)
+  for (unsigned long i = 0; i < level_elems; i++)
   {
+    pme pelem = elem_at (i);
+
+    if (!pelem) ///< group isn't installed
+      continue;
+
     if (pelem->pmap)
     {
       pelem->pmap->remove_all_unsafe ();
@@ -1062,32 +1548,33 @@ void multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 
     pelem->pval-> ~Tvalue ();
 
-    allocator.deallocate (pelem->pval), pelem->pval = 0;
+    pelem->free_value_buffer (allocator, pelem->pval), pelem->pval = 0;
 
     atomic_dec (& use_counter);
   }
 }
 
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-void multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+void multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: remove_all ()
 {
-  if (!storage || !level_elems)
+  if (!has_storage () )
   { brk (); return; }
 
-  pme top_storage = storage + level_elems;
-
   /// Move to ahead of map array
-  for (pme pelem = storage; pelem < top_storage; pelem++)
+  for (unsigned long i = 0; i < level_elems; i++)
   {
-    if (pelem->pmap)
-    {
+    pme pelem = elem_at (i);
+
+    if (!pelem) ///< group isn't installed
+      continue;
+
+    if (pelem->pmap) ///< sub map is emptied, it's freed by destructor only
       pelem->pmap->remove_all ();
-      delete pelem->pmap, pelem->pmap = 0;
-    }
 
-    if (TS_LIVE_SIGN != pelem->status)
+    if (TS_LIVE_SIGN != get_status (pelem))
     {
       if (erase_dead (pelem) )
       {
@@ -1107,7 +1594,7 @@ void multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
       continue;
     }
 
-    if (TS_LIVE_SIGN != pelem->status)
+    if (TS_LIVE_SIGN != get_status (pelem))
     {
       unlock (pelem);
       continue;
@@ -1118,17 +1605,21 @@ void multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 }
 
 /// Check and lock LIVE element else go down in to lower map
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: look_for_live_elem (mp& pos, Tkey& key, Thash& hash, Tvalue*& pvalue)
 {
-  if (!storage) { brk (); return false; }
+  if (!has_storage () ) { brk (); return false; }
 
   /// Look for LIVE element or not empty low map
   for (; pos.elem < level_elems; pos.cnt++, pos.elem++)
   {
-    register pme pelem = & storage [pos.elem];
+    register pme pelem = elem_at (pos.elem);
+
+    if (!pelem) ///< group isn't installed
+      continue;
 
     if (pelem->pmap)
     {/// Store current location
@@ -1139,7 +1630,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 	return true;
     }
 
-    if (TS_LIVE_SIGN != pelem->status)
+    if (TS_LIVE_SIGN != get_status (pelem))
     {
       if (erase_dead (pelem) )
       {
@@ -1158,14 +1649,14 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
       continue;
     }
 
-    if (TS_LIVE_SIGN != pelem->status)
+    if (TS_LIVE_SIGN != get_status (pelem))
     {
       unlock (pelem);
       continue;
     }
 
     key    = pelem->key;
-    hash   = pelem->hash;
+    hash   = elem_hash (pos.elem);
     pvalue = pelem->pval;
     return true;
   } ///< End while pos.elem <= level_elems
@@ -1180,8 +1671,9 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 }
 
 /// Next maps enumerating & if failure than unlock last element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: next (mp& pos, Tkey& key, Thash& hash, Tvalue*& pvalue)
 {
@@ -1200,7 +1692,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
   else
   {
     /// Process previous element
-    register pme pelem = & storage [pos.elem];
+    register pme pelem = elem_at (pos.elem);
     unlock (pelem);
   }
 
@@ -1211,8 +1703,9 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 }
 
 /// Begin maps enumerating & if successfull than lock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: start (mp& pos, Tkey& key, Thash& hash, Tvalue*& pvalue)
 {
@@ -1228,8 +1721,9 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
 }
 
 /// Next maps enumerating by hash & if failure than unlock last element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tstore, long Tlevel_length,
+          class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tstore,       Tlevel_length,       Treclaim>
 
 :: next (mp& pos, Thash hash, Tvalue*& pvalue)
 {
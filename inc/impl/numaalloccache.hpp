@@ -0,0 +1,172 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file numaalloccache.hpp
+ *
+ *  Abstract:		\brief NUMA local memory allocating cache, one interlocked queue cache per node.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: iqalloc_cache, numa_nodes_number, current_numa_node, allocator
+ *  Internal: numa_alloc_cache
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __NUMAALLOCCACHE_HPP__
+#define __NUMAALLOCCACHE_HPP__
+
+#include "impl/iqalloccache.hpp"
+#include "impl/tsnuma.h"
+
+namespace tstl {
+
+/// NUMA local allocating cache
+/** Every node has own cache with storage placed on node and aligned blocks. Get takes buffer
+  * from cache of node which runs calling thread and tries other nodes when it's empty, so
+  * buffers go to global mempool only when all caches are empty. Owner of buffer is found by
+  * range compare over nodes, buffer is reverted to its own node. */
+template <class Tvalue = char, class Tallocator = allocator, class Taux_allocator = Tallocator,
+          class Talloc_cache = iqalloc_cache <Tvalue, Tallocator, Taux_allocator>,
+          long Tmax_nodes = TS_MAX_NUMA_NODES>
+
+class numa_alloc_cache
+{
+  Talloc_cache* caches [Tmax_nodes];
+  long nodes_number;
+
+  const bool dont_use_global_mempool; /// allocating behaviour
+
+  Tallocator allocator;
+
+  Tvalue* get_from_global_mempool (const size_t size)
+  {
+    if (dont_use_global_mempool)
+      return 0;
+
+    return (Tvalue*) allocator.allocate (sizeof (Tvalue) * size);
+  }
+
+  /// Node of buffer or -1
+  long owner_node (Tvalue* buffer) const
+  {
+    for (long i = 0; i < nodes_number; i++)
+      if (caches [i] && caches [i]->is_address_from_cache (buffer) )
+        return i;
+
+    return -1;
+  }
+
+public:
+
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  /** \param num_elem is number of buffers per node */
+  numa_alloc_cache (const size_t buffer_size = 0x400,
+                    const long num_elem       = TS_MAX_TRY_COUNTER,
+                    const long try_counter    = TS_MAX_TRY_COUNTER,
+                    const bool in_dont_use_global_mempool = false)
+                  : nodes_number (0), dont_use_global_mempool (in_dont_use_global_mempool)
+  {
+    memset (caches, 0, sizeof (caches) );
+
+    long number = numa_nodes_number ();
+
+    if (number > Tmax_nodes)
+      number = Tmax_nodes;
+
+    for (long i = 0; i < number; i++)
+    {
+      caches [i] = new Talloc_cache (buffer_size, num_elem, try_counter, true, 0, true, i);
+      if (!caches [i]) { brk (); return; }
+
+      nodes_number++;
+    }
+  }
+
+  ~numa_alloc_cache ()
+  {
+    for (long i = 0; i < nodes_number; i++)
+      if (caches [i]) { delete caches [i], caches [i] = 0; }
+  }
+
+  /// Number of node caches
+  long get_nodes_number () const
+  { return nodes_number; }
+
+  bool is_empty () const
+  { return 0 == get_stat (); }
+
+  /// Get statistic about cache using
+  /** \param node is numa node, -1 means all nodes */
+  long get_stat (long node = -1) const
+  {
+    if (-1 != node)
+      return node < nodes_number && caches [node] ? caches [node]->get_stat () : 0;
+
+    long used = 0;
+
+    for (long i = 0; i < nodes_number; i++)
+      if (caches [i]) used += caches [i]->get_stat ();
+
+    return used;
+  }
+
+  bool is_address_from_cache (Tvalue* buffer) const
+  { return -1 != owner_node (buffer); }
+
+  bool is_size_enough (const size_t size) const
+  { return nodes_number && caches [0]->is_size_enough (size); }
+
+  /** \param size is amount of symbols <Tvalue> in buffer */
+  Tvalue* get (const size_t size)
+  {
+    if (!nodes_number) { brk (); return get_from_global_mempool (size); }
+
+    long node = current_numa_node ();
+
+    if (node < 0 || node >= nodes_number)
+      node = 0;
+
+    for (long i = 0; i < nodes_number; i++, node = (node + 1) % nodes_number)
+    {
+      if (!caches [node]->is_size_enough (size) )
+        break;
+
+      Tvalue* buffer = caches [node]->get (size);
+
+      if (buffer)
+        return buffer;
+    }
+
+    return get_from_global_mempool (size);
+  }
+
+  bool revert (Tvalue* buffer)
+  {
+    if (!buffer) { brk (); return false; }
+
+    long node = owner_node (buffer);
+
+    if (-1 != node)
+      return caches [node]->revert (buffer);
+
+    if (dont_use_global_mempool)
+    { brk (); return false; }
+
+    allocator.deallocate ( (char*) buffer), buffer = 0;
+    return true;
+  }
+};
+
+}; /* end of tstl namespace */
+
+#endif /* __NUMAALLOCCACHE_HPP__ */
@@ -10,7 +10,7 @@
  *
  *  Classes, methods and structures: \details
  *
- *  External:	hash_key, ts_sleep, allocator, melocker
+ *  External:	hash_key, ts_sleep, allocator, melocker, wait_reclaim, epoch_reclaim
  *  Internal:	multimap, map_pos || mp
  *
  *  TODO:		\todo
@@ -25,19 +25,29 @@
 #include "impl/tshash.hpp"
 #include "impl/tslist.hpp"
 #include "impl/relocker.hpp"
+#include "impl/tsepoch.hpp"
 
 namespace tstl  {
 namespace pbmap {
 
+#define PB_MAP_UNGUARDED_REF 0x10000 ///< reference of holder out of epoch, remover waits for it
+
 typedef struct map_pos
 {
   plh plist_entry;
   plh plist_head;
   unsigned long map_elem;
-  map_pos () : plist_entry (0), plist_head (0), map_elem (0) {}
+  bool guarded; ///< holder of position is in epoch of reclamation policy
+  map_pos () : plist_entry (0), plist_head (0), map_elem (0), guarded (false) {}
 } mp, *pmp;
 
-template <class Tkey, class Tvalue, class Thash = size_t, class Tallocator = allocator, class Tlocker = melocker <> >
+/// Hash table of linked lists, list is locked by its locker while position in it is held
+/** Treclaim is freeing policy of removed list entries. With wait_reclaim remover waits for other
+  * positions on entry, with epoch_reclaim entry is unlinked at once and retired into epoch
+  * domain, held positions are in epoch and entries are freed by batches after they leave.
+  * Holder which can't enter epoch takes PB_MAP_UNGUARDED_REF reference and remover waits for it. */
+template <class Tkey, class Tvalue, class Thash = size_t, class Tallocator = allocator, class Tlocker = melocker <>,
+          class Treclaim = wait_reclaim>
 
 class multimap
 {
@@ -79,25 +89,39 @@ class multimap
 
   /// Private map methods
 
-  /// Lock reference on element
-  void lock (plh& plist_entry)
-  { atomic_inc ( & ( (ple) plist_entry)->ref); }
+  /// Lock reference on element of position, holder of reference is in epoch of deferred policy
+  void lock (mp& pos)
+  {
+    pos.guarded = Treclaim :: enter ();
+    atomic_add_return (& ( (ple) pos.plist_entry)->ref, pos.guarded ? 1 : PB_MAP_UNGUARDED_REF);
+  }
+
+  /// Free reference of position on element
+  void release (mp& pos, plh plist_entry)
+  {
+    atomic_add_return (& ( (ple) plist_entry)->ref, pos.guarded ? -1 : - PB_MAP_UNGUARDED_REF);
+
+    if (pos.guarded)
+      Treclaim :: leave (), pos.guarded = false;
+  }
 
-  /// Free reference on element
-  void release (plh& plist_entry)
-  { atomic_dec ( & ( (ple) plist_entry)->ref); }
+  /// Destroy value and free list entry, it's called by epoch domain after positions are released
+  static void free_entry (void* pointer, void* context)
+  {
+    void* unused_context = context;
+    Tallocator allocator;
 
-  /// Synoname of Release
-  void unlock (plh& plist_entry)
-  { release (plist_entry); }
+    ( (Tvalue*) ( ( (ple) pointer) + 1) ) -> ~Tvalue ();
+    allocator.deallocate (pointer);
+  }
 
   bool remove (plh& plist_entry, plh plist_head);
 
   /// Search list entry by key & lock it
-  bool search_by_key  (plh& plist_entry, plh plist_head, Tkey key);
+  bool search_by_key  (mp& pos, Tkey key);
 
   /// Search list entry by hash & lock it
-  bool search_by_hash (plh& plist_entry, plh plist_head, Thash hash);
+  bool search_by_hash (mp& pos, Thash hash);
 
   /// Doesn't thread safe method, it called from destructor
   void remove_all_unsafe ();
@@ -160,7 +184,7 @@ public:
   /// Unlock position in map
   void release (mp& pos)
   {
-    release (pos.plist_entry);
+    release (pos, pos.plist_entry);
     storage [pos.map_elem].lk.unlock (); ///< Unlock linked list
   }
 
@@ -201,8 +225,8 @@ public:
   bool next (mp& pos, Thash hash, Tvalue*& pvalue);
 };
 
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: remove (plh& plist_entry, plh plist_head)
 {
@@ -212,6 +236,14 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 
   list_del (plist_entry);
 
+  if (Treclaim :: is_deferred) ///< held positions could go next by entry till they are released
+  {
+    Treclaim :: retire (plist_entry, free_entry);
+
+    atomic_dec (& use_counter);
+    return true;
+  }
+
 #if defined (DEBUG)
   plist_entry->next = plist_entry->prev = 0;
 #endif
@@ -225,11 +257,14 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Search list entry by key & lock it
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
-:: search_by_key (plh& plist_entry, plh plist_head, Tkey key)
+:: search_by_key (mp& pos, Tkey key)
 {
+  plh& plist_entry = pos.plist_entry;
+  plh  plist_head  = pos.plist_head;
+
   if (list_empty (plist_head))
     return false;
 
@@ -264,7 +299,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 
     if ( ( (ple) plist_entry)->key == key)
     {
-      lock (plist_entry);
+      lock (pos);
 
       return true;
     }
@@ -274,11 +309,14 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Search list entry by hash & lock it
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
-:: search_by_hash (plh& plist_entry, plh plist_head, Thash hash)
+:: search_by_hash (mp& pos, Thash hash)
 {
+  plh& plist_entry = pos.plist_entry;
+  plh  plist_head  = pos.plist_head;
+
   if (list_empty (plist_head))
     return false;
 
@@ -313,7 +351,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 
     if ( ( (ple) plist_entry)->hash == hash)
     {
-      lock (plist_entry);
+      lock (pos);
       return true;
     }
   }
@@ -321,8 +359,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
   return false;
 }
 
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-multimap       <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+multimap       <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: multimap (const Thash root_array_elems = 32) : max_elem (root_array_elems)
 {
@@ -337,8 +375,8 @@ multimap       <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Insert element in map & if successfull than lock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: set_at (mp& pos, Tkey key, Thash hash, const Tvalue* pvalue)
 {
@@ -356,7 +394,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
   //*( (Tvalue*) ( ( (ple) pos.plist_entry) + 1) ) = *pvalue;
   :: new ( (void*) ( ( (ple) pos.plist_entry) + 1), a) Tvalue (*pvalue);
 
-  ( (ple) pos.plist_entry)->ref  = 1; ///< Lock element
+  pos.guarded = Treclaim :: enter ();
+  ( (ple) pos.plist_entry)->ref  = pos.guarded ? 1 : PB_MAP_UNGUARDED_REF; ///< Lock element
   ( (ple) pos.plist_entry)->status = TS_LIVE_SIGN;
 
   pos.map_elem = (unsigned long) hash % max_elem;
@@ -373,8 +412,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Look for element in map by key & if successfull search than lock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: lookup_by_key (mp& pos, Tkey key, Tvalue*& pvalue)
 {
@@ -385,7 +424,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 
   storage [pos.map_elem].lk.lock (); ///< Lock linked list
 
-  if (!search_by_key (pos.plist_entry, pos.plist_head, key))
+  if (!search_by_key (pos, key))
   {
     storage [pos.map_elem].lk.unlock (); ///< Unlock linked list
     return false;
@@ -396,8 +435,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Look for element in map by keys hash & if successfull search than lock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: lookup_by_key_hash (mp& pos, Tkey key, Tvalue*& pvalue)
 {
@@ -409,7 +448,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 
   storage [pos.map_elem].lk.lock (); ///< Lock linked list
 
-  if (!search_by_hash (pos.plist_entry, pos.plist_head, hash))
+  if (!search_by_hash (pos, hash))
   {
     storage [pos.map_elem].lk.unlock (); ///< Unlock linked list
     return false;
@@ -420,8 +459,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Look for element in map by hash & if successfull search than lock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: lookup_by_hash (mp& pos, Thash hash, Tvalue*& pvalue)
 {
@@ -432,7 +471,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 
   storage [pos.map_elem].lk.lock (); ///< Lock linked list
 
-  if (!search_by_hash (pos.plist_entry, pos.plist_head, hash))
+  if (!search_by_hash (pos, hash))
   {
     storage [pos.map_elem].lk.unlock (); ///< Unlock linked list
     return false;
@@ -444,8 +483,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 
 /// Remove element from map by ListEntry and always unlock element
 /** \return false if list entry destroyed */
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: remove (mp& pos)
 {
@@ -473,7 +512,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
   long status = atomic_compare_exchange (& ( (ple) pos.plist_entry)->status, TS_KILL_SIGN, TS_LIVE_SIGN);
 
   /// Release element
-  release (pos.plist_entry);
+  release (pos, pos.plist_entry);
 
   /// List element status control
   if (TS_LIVE_SIGN != status)
@@ -519,7 +558,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
   /// Try to lock reference counter for using
   long ref = atomic_dec_return (& ( (ple) pos.plist_entry)->ref);
 
-  if (ref < 0)
+  /// deferred policy doesn't wait for other positions, if they all are in epoch
+  if (ref < 0 || (Treclaim :: is_deferred && ref < PB_MAP_UNGUARDED_REF - 1) )
   {
     /// Reference counter locked successfull
     remove (pos.plist_entry, pos.plist_head);
@@ -574,8 +614,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Remove element from map by key
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: remove_by_key (Tkey key)
 {
@@ -589,8 +629,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Remove element from map by keys hash
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: remove_by_key_hash (Tkey key)
 {
@@ -604,8 +644,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Remove element from map by hash
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: remove_by_hash (Thash hash)
 {
@@ -619,8 +659,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Remove all elements in map
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-void multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+void multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: remove_all ()
 {
@@ -638,8 +678,8 @@ void multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Doesn't thread safe method, it called from destructor
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-void multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+void multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: remove_all_unsafe ()
 {
@@ -666,8 +706,8 @@ void multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Begin maps enumerating & if successfull than lock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: start (mp& pos, Tkey& key, Thash& hash, Tvalue*& pvalue)
 {
@@ -727,7 +767,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
       continue; 
     }
 
-    lock (pos.plist_entry);
+    lock (pos);
 
     key  = ( (ple) pos.plist_entry)->key;
     hash = ( (ple) pos.plist_entry)->hash;
@@ -739,8 +779,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Next maps enumerating & if failure than unlock last element
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: next (mp& pos, Tkey& key, Thash& hash, Tvalue*& pvalue)
 {
@@ -758,7 +798,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
     pos.plist_entry = pos.plist_entry->next;
 
     if (plist_entry_prev != pos.plist_head)
-	release (plist_entry_prev);
+	release (pos, plist_entry_prev);
 
     if (!pos.plist_entry)
     {
@@ -796,7 +836,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 
     if (pos.plist_entry != pos.plist_head)
     {	
-      lock (pos.plist_entry);
+      lock (pos);
 
       key  = ( (ple) pos.plist_entry)->key;
       hash = ( (ple) pos.plist_entry)->hash;
@@ -828,8 +868,8 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
 }
 
 /// Next maps enumerating by hash (AKA multimap) & if failure than unlock last element
-template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker>
-bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Tlocker, class Treclaim>
+bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker,       Treclaim>
 
 :: next (mp& pos, Thash hash, Tvalue*& pvalue)
 {
@@ -845,7 +885,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
   pos.plist_entry = pos.plist_entry->next;
 
   if (plist_entry_prev != pos.plist_head)
-    release (plist_entry_prev);
+    release (pos, plist_entry_prev);
 
   if (!pos.plist_entry)
   {
@@ -884,7 +924,7 @@ bool multimap  <Tkey,       Tvalue,       Thash,       Tallocator,       Tlocker
     /// Bingo !!! Founded equial hash - time to change hash function !!!
     brk ();
 
-    lock (pos.plist_entry);
+    lock (pos);
 
     pvalue = lookup (pos);
     return true;
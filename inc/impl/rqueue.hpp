@@ -0,0 +1,184 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file rqueue.hpp
+ *
+ *  Abstract:		\brief Bounded interlocked ring queue with many writers and many readers.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: allocator, atomic_load_acquire, atomic_store_release, atomic_compare_exchange_relaxed
+ *  Internal: rqueue
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __RQUEUE_HPP__
+#define __RQUEUE_HPP__
+
+#include "tstl.hpp"
+
+namespace tstl {
+
+/// Ring queue (Vyukov's bounded MPMC queue)
+/** Every cell has sequence number. Writer owns cell when sequence is equal to head position,
+  * reader owns cell when sequence is equal to tail position + 1. Head and tail are moved by CAS
+  * and live on own cache lines. Cells are allocated once, put on full queue returns false. */
+template <class Tvalue = size_t, class Tallocator = allocator>
+
+class rqueue
+{
+  typedef struct ring_cell { volatile long sequence; Tvalue value; } rc, *prc;
+
+  prc  cells;
+  long mask;                ///< cells number - 1, cells number is power of 2
+
+  char head_pad [TS_CACHE_LINE_SIZE - sizeof (prc) - sizeof (long)];
+  volatile long head;       ///< writers position
+  char tail_pad [TS_CACHE_LINE_SIZE - sizeof (long)];
+  volatile long tail;       ///< readers position
+  char end_pad  [TS_CACHE_LINE_SIZE - sizeof (long)];
+
+  Tallocator allocator;
+
+public:
+
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  /** \param capacity is rounded up to power of 2 */
+  rqueue (const long capacity = 64) : cells (0), mask (0), head (0), tail (0)
+  {
+    long cells_number = 2;
+
+    while (cells_number < capacity)
+      cells_number <<= 1;
+
+    cells = (prc) allocator.allocate (cells_number * sizeof (*cells) );
+
+    if (!cells) { brk (); return; }
+
+    memset (cells, 0, cells_number * sizeof (*cells) );
+
+    for (long i = 0; i < cells_number; i++)
+      cells [i].sequence = i;
+
+    mask = cells_number - 1;
+  }
+
+  ~rqueue ()
+  { if (cells) { allocator.deallocate (cells), cells = 0; } else { brk (); } }
+
+  /// Is not thread safe method
+  bool is_empty () const
+  { return head == tail; }
+
+  /// Get statistic about queue using
+  long get_stat () const
+  { return head - tail; }
+
+  /// Stores Tvalues.
+  /** \param[in] buffer is pointer to Tvalues
+    * \return true if Tvalues put into queue, false if queue is full. */
+  bool put (Tvalue* buffer);
+
+  /// Retrives Tvalues.
+  /** \param[in] buffer is pointer to Tvalues
+    * \return true if Tvalues get from queue. */
+  bool get (Tvalue* buffer);
+};
+
+/// Stores Tvalues.
+/** \param[in] buffer is pointer to Tvalues
+  * \return true if Tvalues put into queue, false if queue is full. */
+template <class Tvalue, class Tallocator>
+bool rqueue    <Tvalue,       Tallocator>
+
+:: put (Tvalue* buffer)
+{
+  if (!buffer || !cells) { brk (); return false; }
+
+  prc  pc  = 0;
+  long pos = atomic_load_relaxed (& head);
+
+  for (;;)
+  {
+    pc = & cells [pos & mask];
+
+    long diff = atomic_load_acquire (& pc->sequence) - pos;
+
+    if (!diff)
+    { ///< cell is free, try to own it
+      long prev = atomic_compare_exchange_relaxed (& head, pos + 1, pos);
+
+      if (prev == pos)
+        break;
+
+      pos = prev;
+    }
+    else if (diff < 0)
+      return false; ///< queue is full
+    else
+      pos = atomic_load_relaxed (& head); ///< other writer took cell
+  }
+
+  tstl :: allocator a;
+  :: new ( (void*) & pc->value, a) Tvalue (*buffer);
+
+  atomic_store_release (& pc->sequence, pos + 1); ///< cell is given to readers
+
+  return true;
+}
+
+/// Retrives Tvalues.
+/** \param[in] buffer is pointer to Tvalues
+  * \return true if Tvalues get from queue. */
+template <class Tvalue, class Tallocator>
+bool rqueue    <Tvalue,       Tallocator>
+
+:: get (Tvalue* buffer)
+{
+  if (!buffer || !cells) { brk (); return false; }
+
+  prc  pc  = 0;
+  long pos = atomic_load_relaxed (& tail);
+
+  for (;;)
+  {
+    pc = & cells [pos & mask];
+
+    long diff = atomic_load_acquire (& pc->sequence) - (pos + 1);
+
+    if (!diff)
+    { ///< cell is full, try to own it
+      long prev = atomic_compare_exchange_relaxed (& tail, pos + 1, pos);
+
+      if (prev == pos)
+        break;
+
+      pos = prev;
+    }
+    else if (diff < 0)
+      return false; ///< queue is empty
+    else
+      pos = atomic_load_relaxed (& tail); ///< other reader took cell
+  }
+
+  tstl :: allocator a;
+  :: new ( (void*) buffer, a) Tvalue (pc->value);
+
+  atomic_store_release (& pc->sequence, pos + mask + 1); ///< cell is given to writers of next round
+
+  return true;
+}
+
+}; /* end of tstl namespace */
+
+#endif /* __RQUEUE_HPP__ */
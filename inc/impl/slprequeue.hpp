@@ -0,0 +1,472 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file slprequeue.hpp
+ *
+ *  Abstract:		\brief Skip list priority queue, lock free engine for sparse and continuous prioritets.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: allocator, epoch_domain, epoch_reclaim, eventcount, min_top, max_top
+ *  Internal: slprequeue
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __SLPREQUEUE_HPP__
+#define __SLPREQUEUE_HPP__
+
+#include "impl/hprequeue.hpp"
+#include "impl/tsepoch.hpp"
+
+#define TS_SLPREQUEUE_LEVELS 24  ///< maximal height of node, level is 4 times sparser than lower one
+#define TS_SLPREQUEUE_SLOTS  256 ///< threads which use skip list queues at same time
+
+namespace tstl {
+
+#if defined (TS_EPOCH_HAS_SLOTS)
+
+/// Skip list priority queue
+/** Every message is node of lock free skip list sorted by prioritet and put order, so any long
+  * is prioritet, same prioritets go by FIFO and there isn't queue object per prioritet. Put
+  * links node by compare exchange from level 0 up, get_top takes first node of level 0 by
+  * marking its link (delete-min), get takes first node of exact prioritet. Taken node is
+  * marked on all levels and unlinked by search, last of putter and getter retires it into
+  * epoch domain, so readers walk nodes without locks and references. put, get, put_wait and
+  * get_wait are same as prequeue has, so it's engine of prequeue. Thread which can't enter
+  * domain (all Tdomain slots are taken by other threads) doesn't touch list, its put and
+  * get fail. It's user mode engine, epoch domain hasn't thread slots in kernel mode. */
+template <class Tvalue, class Tallocator = allocator, class Ttop = min_top,
+          class Tdomain = epoch_domain <Tallocator, TS_SLPREQUEUE_SLOTS> >
+
+class slprequeue
+{
+  typedef epoch_reclaim <Tdomain> reclaim;
+
+  typedef struct skip_node
+  {
+    long prioritet;
+    unsigned long sequence;  ///< put order of same prioritets, key of node is unique
+    long ref;                ///< putter and getter, last of them retires unlinked node
+    long height;
+    Tvalue value;
+    void* volatile next [1]; ///< links of levels allocated by height, low bit marks taken node
+  } sn, *psn;
+
+  psn head;                  ///< sentinel of TS_SLPREQUEUE_LEVELS height
+
+  char sequence_pad [TS_CACHE_LINE_SIZE];
+  volatile long sequence;
+
+  char counter_pad [TS_CACHE_LINE_SIZE];
+  volatile long use_counter;
+
+  char end_pad [TS_CACHE_LINE_SIZE];
+
+  Tallocator allocator;
+
+  eventcount not_empty; ///< readers wait on it
+
+  static psn link_node (void* link)
+  { return (psn) ( (size_t) link & ~(size_t) 1); }
+
+  static bool is_marked (void* link)
+  { return 0 != ( (size_t) link & 1); }
+
+  static void* mark_link (void* link)
+  { return (void*) ( (size_t) link | 1); }
+
+  /// Node goes before key of prioritet and sequence
+  static bool before (const psn pn, const long prioritet, const unsigned long sequence)
+  {
+    if (pn->prioritet != prioritet)
+      return Ttop :: above (pn->prioritet, prioritet);
+
+    return (long) (pn->sequence - sequence) < 0;
+  }
+
+  /// Height of node by mixed put order, it's 1 + n with probability 1 / 4^n
+  static long node_height (unsigned long bits)
+  {
+    bits *= 0x9e3779b1UL, bits ^= bits >> 15;
+    bits *= 0x85ebca77UL, bits ^= bits >> 13;
+
+    long height = 1;
+
+    for (; height < TS_SLPREQUEUE_LEVELS && !(bits & 3); bits >>= 2)
+      height++;
+
+    return height;
+  }
+
+  /// Destroy value and free node, it's called by epoch domain after readers leave
+  static void free_node (void* pointer, void*)
+  {
+    Tallocator allocator;
+
+    ( (psn) pointer)->value. ~Tvalue ();
+    allocator.deallocate (pointer);
+  }
+
+  /// Last of putter and getter retires node
+  void release_node (psn pn)
+  {
+    if (!atomic_dec_return (& pn->ref) )
+      reclaim :: retire (pn, free_node);
+  }
+
+  /// Predecessors and successors of key on every level, taken nodes on the way are unlinked
+  void find (const long prioritet, const unsigned long sequence, psn* preds, psn* succs);
+
+  /// First node of level 0, or first node which prioritet isn't above of prioritet if it's exact
+  psn first_node (const bool exact, const long prioritet);
+
+  /// Take first not taken node by marking of its level 0 link
+  psn take (psn pn, const bool exact, const long prioritet);
+
+  /// Mark upper levels of taken node, copy its value and unlink it
+  void remove (psn pn, Tvalue* buffer, long* prioritet);
+
+  /// Take and remove node, Retrives Tvalues
+  bool get_node (Tvalue* buffer, const bool exact, long* prioritet);
+
+public:
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  /// Sizes of prequeue constructor aren't used, nodes are allocated by height
+  slprequeue (const long = 0, const unsigned long = 0) : sequence (0), use_counter (0)
+  {
+    size_t size = sizeof (*head) + sizeof (void*) * (TS_SLPREQUEUE_LEVELS - 1);
+
+    head = (psn) allocator.allocate (size);
+    if (!head) { brk (); return; }
+
+    memset (head, 0, size); ///< value of sentinel isn't constructed
+    head->height = TS_SLPREQUEUE_LEVELS;
+  }
+
+  /// Doesn't thread safe method, taken nodes are retired already
+  ~slprequeue ();
+
+  /// Is not thread safe method
+  bool is_empty () const
+  { return 0 == use_counter; }
+
+  /// Get statistic about queue using
+  long get_stat () const
+  { return use_counter; }
+
+  /// Stores Tvalues.
+  /** \param[in] buffer is pointer to Tvalues
+    * \param[in] prioritet is any long, Ttop tells which one is more urgent
+    * \return true if Tvalues put into queue. */
+  bool put (Tvalue* buffer, long prioritet = 0);
+
+  /// Retrives Tvalues of prioritet.
+  /** \param[in] buffer is pointer to Tvalues
+    * \param[in] prioritet is prioritet of Tvalues
+    * \return true if Tvalues get from queue. */
+  bool get (Tvalue* buffer, long prioritet = 0)
+  { return get_node (buffer, true, & prioritet); }
+
+  /// Retrives Tvalues of most urgent prioritet.
+  /** \param[in] buffer is pointer to Tvalues
+    * \param[out] prioritet is prioritet of Tvalues if it isn't 0
+    * \return true if Tvalues get from queue. */
+  bool get_top (Tvalue* buffer, long* prioritet = 0)
+  { return get_node (buffer, false, prioritet); }
+
+  /// Queue isn't bounded, it's put
+  bool put_wait (Tvalue* buffer, long prioritet = 0, long /* timeout */ = TS_INFINITE_TIMEOUT)
+  { return put (buffer, prioritet); }
+
+  /// Retrives Tvalues of prioritet, waits while there aren't Tvalues of it.
+  /** \param[in] timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if queue is closed and there aren't Tvalues of prioritet. */
+  bool get_wait (Tvalue* buffer, long prioritet = 0, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    bool rc = false;
+    ts_event_wait (not_empty, get (buffer, prioritet), timeout, rc);
+    return rc;
+  }
+
+  /// Retrives Tvalues of most urgent prioritet, waits while queue is empty.
+  /** \param[in] timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if queue is closed and empty. */
+  bool get_top_wait (Tvalue* buffer, long* prioritet = 0, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    bool rc = false;
+    ts_event_wait (not_empty, get_top (buffer, prioritet), timeout, rc);
+    return rc;
+  }
+
+  /// Wake all waiters for shutdown
+  void close ()
+  { not_empty.close (); }
+};
+
+/// Predecessors and successors of key on every level, taken nodes on the way are unlinked
+template <class Tvalue, class Tallocator, class Ttop, class Tdomain>
+void slprequeue <Tvalue,       Tallocator,       Ttop,       Tdomain>
+
+:: find (const long prioritet, const unsigned long sequence, psn* preds, psn* succs)
+{
+  bool restart = true;
+
+  while (restart)
+  {
+    restart = false;
+
+    psn pred = head;
+
+    for (long level = TS_SLPREQUEUE_LEVELS - 1; level >= 0 && !restart; level--)
+    {
+      psn curr = link_node (atomic_load_acquire (& pred->next [level]) );
+
+      while (curr)
+      {
+        void* succ = atomic_load_acquire (& curr->next [level]);
+
+        if (is_marked (succ) ) ///< curr is taken, it's unlinked on this level
+        {
+          if (curr != atomic_compare_exchange ( (void**) & pred->next [level], link_node (succ), curr) )
+          { restart = true; break; } ///< pred is taken or changed
+
+          curr = link_node (succ);
+          continue;
+        }
+
+        if (!before (curr, prioritet, sequence) )
+          break;
+
+        pred = curr, curr = link_node (succ);
+      }
+
+      preds [level] = pred, succs [level] = curr;
+    }
+  }
+}
+
+/// First node of level 0, or first node which prioritet isn't above of prioritet if it's exact
+template <class Tvalue, class Tallocator, class Ttop, class Tdomain>
+typename slprequeue <Tvalue, Tallocator, Ttop, Tdomain> :: psn slprequeue <Tvalue, Tallocator, Ttop, Tdomain>
+
+:: first_node (const bool exact, const long prioritet)
+{
+  psn pred = head;
+
+  for (long level = TS_SLPREQUEUE_LEVELS - 1; exact && level >= 0; level--)
+  {
+    psn curr = link_node (atomic_load_acquire (& pred->next [level]) );
+
+    for (; curr && Ttop :: above (curr->prioritet, prioritet);
+           curr = link_node (atomic_load_acquire (& curr->next [level]) ) )
+      pred = curr;
+  }
+
+  return link_node (atomic_load_acquire (& pred->next [0]) );
+}
+
+/// Take first not taken node by marking of its level 0 link
+template <class Tvalue, class Tallocator, class Ttop, class Tdomain>
+typename slprequeue <Tvalue, Tallocator, Ttop, Tdomain> :: psn slprequeue <Tvalue, Tallocator, Ttop, Tdomain>
+
+:: take (psn pn, const bool exact, const long prioritet)
+{
+  while (pn)
+  {
+    void* succ = atomic_load_acquire (& pn->next [0]);
+
+    /// node is taken by other getter or it's put before prioritet after search
+    if (is_marked (succ) || (exact && Ttop :: above (pn->prioritet, prioritet) ) )
+    { pn = link_node (succ); continue; }
+
+    if (exact && pn->prioritet != prioritet)
+      return 0;
+
+    if (succ == atomic_compare_exchange ( (void**) & pn->next [0], mark_link (succ), succ) )
+      return pn;
+
+    /// node is put after pn or pn is taken, it's looked at again
+  }
+
+  return 0;
+}
+
+/// Mark upper levels of taken node, copy its value and unlink it
+template <class Tvalue, class Tallocator, class Ttop, class Tdomain>
+void slprequeue <Tvalue,       Tallocator,       Ttop,       Tdomain>
+
+:: remove (psn pn, Tvalue* buffer, long* prioritet)
+{
+  for (long level = pn->height - 1; level > 0; level--)
+  {
+    void* succ = atomic_load_acquire (& pn->next [level]);
+
+    while (!is_marked (succ) )
+    {
+      void* prev = atomic_compare_exchange ( (void**) & pn->next [level], mark_link (succ), succ);
+
+      if (prev == succ)
+        break;
+
+      succ = prev;
+    }
+  }
+
+  /// copy value from node
+  tstl :: allocator a;
+  :: new ( (void*) buffer, a) Tvalue (pn->value);
+
+  if (prioritet)
+    *prioritet = pn->prioritet;
+
+  psn preds [TS_SLPREQUEUE_LEVELS], succs [TS_SLPREQUEUE_LEVELS];
+
+  find (pn->prioritet, pn->sequence, preds, succs); ///< node is unlinked on all levels
+
+  atomic_dec (& use_counter);
+  release_node (pn);
+}
+
+/// Take and remove node, Retrives Tvalues
+template <class Tvalue, class Tallocator, class Ttop, class Tdomain>
+bool slprequeue <Tvalue,       Tallocator,       Ttop,       Tdomain>
+
+:: get_node (Tvalue* buffer, const bool exact, long* prioritet)
+{
+  if (!buffer || !head) { brk (); return false; }
+
+  if (!reclaim :: enter () )
+  { brk (); return false; } ///< all slots of domain are taken
+
+  long key = exact ? *prioritet : 0;
+  psn pn = take (first_node (exact, key), exact, key);
+
+  if (pn)
+    remove (pn, buffer, exact ? 0 : prioritet);
+
+  reclaim :: leave ();
+  return 0 != pn;
+}
+
+/// Stores Tvalues.
+/** \param[in] buffer is pointer to Tvalues
+  * \param[in] prioritet is any long, Ttop tells which one is more urgent
+  * \return true if Tvalues put into queue. */
+template <class Tvalue, class Tallocator, class Ttop, class Tdomain>
+bool slprequeue <Tvalue,       Tallocator,       Ttop,       Tdomain>
+
+:: put (Tvalue* buffer, long prioritet)
+{
+  if (!buffer || !head) { brk (); return false; }
+
+  unsigned long order = (unsigned long) atomic_inc_return ( (long*) & sequence);
+  long height = node_height (order);
+
+  psn pn = (psn) allocator.allocate (sizeof (*pn) + sizeof (void*) * (height - 1) );
+  if (!pn) { brk (); return false; }
+
+  /// put value to node
+  tstl :: allocator a;
+  :: new ( (void*) & pn->value, a) Tvalue (*buffer);
+
+  pn->prioritet = prioritet;
+  pn->sequence  = order;
+  pn->ref       = 2;
+  pn->height    = height;
+
+  if (!reclaim :: enter () )
+  {
+    brk (); ///< all slots of domain are taken
+    free_node (pn, 0);
+    return false;
+  }
+
+  psn preds [TS_SLPREQUEUE_LEVELS], succs [TS_SLPREQUEUE_LEVELS];
+
+  atomic_inc (& use_counter);
+
+  for (;;)
+  {
+    find (prioritet, order, preds, succs);
+
+    for (long level = 0; level < height; level++)
+      pn->next [level] = succs [level];
+
+    if (succs [0] == atomic_compare_exchange ( (void**) & preds [0]->next [0], pn, succs [0]) )
+      break;
+  }
+
+  /// upper levels are linked while node isn't taken by getter
+  bool taken = false;
+
+  for (long level = 1; level < height && !taken; level++)
+  {
+    for (;;)
+    {
+      void* succ = atomic_load_acquire (& pn->next [level]);
+
+      if (is_marked (succ) )
+      { taken = true; break; } ///< mark of getter isn't overwritten by new successor
+
+      if (succ != succs [level]
+       && succ != atomic_compare_exchange ( (void**) & pn->next [level], succs [level], succ) )
+      { taken = true; break; } ///< level is marked by getter
+
+      if (succs [level] == atomic_compare_exchange ( (void**) & preds [level]->next [level], pn, succs [level]) )
+        break;
+
+      find (prioritet, order, preds, succs);
+
+      if (succs [0] != pn)
+      { taken = true; break; } ///< node is unlinked by getter
+    }
+  }
+
+  /// getter could unlink node before upper levels were linked, links are removed again
+  if (is_marked (atomic_load_acquire (& pn->next [0]) ) )
+    find (prioritet, order, preds, succs);
+
+  release_node (pn);
+
+  reclaim :: leave ();
+
+  not_empty.notify_all ();
+  return true;
+}
+
+/// Doesn't thread safe method, taken nodes are retired already
+template <class Tvalue, class Tallocator, class Ttop, class Tdomain>
+slprequeue     <Tvalue,       Tallocator,       Ttop,       Tdomain>
+
+:: ~slprequeue ()
+{
+  if (!head) return;
+
+  psn pn = link_node (head->next [0]);
+
+  while (pn)
+  {
+    psn next = link_node (pn->next [0]);
+
+    free_node (pn, 0);
+    pn = next;
+  }
+
+  allocator.deallocate (head), head = 0;
+}
+
+#endif ///< TS_EPOCH_HAS_SLOTS
+
+}; /* end of tstl namespace */
+
+#endif /* __SLPREQUEUE_HPP__ */
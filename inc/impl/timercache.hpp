@@ -10,7 +10,7 @@
  *
  *  Classes, methods and structures: \details
  *
- *  External:	hash_key, ts_sleep, set_timeout, check_timeout, allocator
+ *  External:	hash_key, ts_sleep, monotonic_time, allocator, wait_reclaim, epoch_reclaim
  *  Internal:	timer_cache
  *
  *  TODO:		\todo
@@ -23,23 +23,23 @@
 #include "tstl.hpp"
 
 #include "impl/tshash.hpp"
+#include "impl/tsepoch.hpp"
+#include "impl/tstime.h"
 
 namespace tstl {
 
 #define SET_AT_TRY_COUNTER 1
 
-#if defined (__GNUC__)
-typedef unsigned long long ulonglong;
-#elif defined (_MSC_VER)
-typedef unsigned __int64   ulonglong;
-#endif
-
 /// Object status cyclo graph
 
 /** +---------------------LOOPBACK----------------------+
   * +-> FREE -> BUSY -> LIVE -> KILL +--------+-> ERAS -+
   *                                  +-> DEAD +        */
-template <class Tkey, class Tvalue, class Thash = size_t, class Tallocator = allocator>
+/** Treclaim is freeing policy of values. With wait_reclaim remover waits for readers of element,
+  * with epoch_reclaim remover marks used element DEAD and goes on, last reader erases it on
+  * release. Every reader holds reference of element, so value is freed at once by erase. */
+template <class Tkey, class Tvalue, class Thash = size_t, class Tallocator = allocator,
+          class Treclaim = wait_reclaim>
 
 class timer_cache
 {
@@ -48,7 +48,7 @@ class timer_cache
     /// redanted service information
     long status; ///< "FREE" || "BUSY" || "LIVE" || "KILL" || "DEAD" || "ERAS"
     long ref;
-    ulonglong lastus;
+    ulonglong lastus; ///< expiration time in milliseconds of monotonic_time
 
     /// usefull payload
     Tvalue* pval;
@@ -97,11 +97,18 @@ class timer_cache
 
   /// Set cache element timer
   void set_timeout (ptce& pelem) const
-  { ::set_timeout ((unsigned long*) & pelem->lastus, (unsigned long*) & cache_timeout); }
+  { pelem->lastus = monotonic_time () + cache_timeout; }
 
   /// Check cache element timer
   bool check_timeout (ptce& pelem) const
-  { return ::check_timeout ((unsigned long*) & pelem->lastus); }
+  { return monotonic_time () >= pelem->lastus; }
+
+  /// Destroy and free value of element, it's erased by last reference holder
+  void free_value (Tvalue* pval)
+  {
+    pval-> ~Tvalue ();
+    allocator.deallocate (pval);
+  }
 
   /// Buble up
   bool buble_up (const long buble_pos);
@@ -139,6 +146,7 @@ public:
   void operator delete (void* p)
   { Tallocator allocator; allocator.deallocate (p); }
 
+  /// Timeout of element is in milliseconds, it is prolonged by every lookup
   timer_cache (const ulonglong timeout, const long num_elem = 32);
 
   ~timer_cache ();
@@ -178,12 +186,17 @@ public:
     return storage [pos].pval;
   }
 
-  /// Free reference on element
+  /// Free reference on element, last reader of element marked DEAD erases it
   long release (long& pos)
   {
     if (!storage || pos >= max_elem) { brk (); return false; }
     ptce pelem = & storage [pos];
-    return release (pelem);
+    long ref = release (pelem);
+
+    if (TS_MINUS_NULL == ref && erase_dead (pelem) )
+      release_remove (pelem);
+
+    return ref;
   }
 
   /// Synonym of release
@@ -239,8 +252,8 @@ public:
 };
 
 /// Buble up
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: buble_up (const long buble_pos)
 {
@@ -252,15 +265,19 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
   long* prev = (long*)(& buble_booster [buble_pos - 1] ); ///< exchange with previous element
   long comperand = *prev;
 
-  if (comperand != atomic_compare_exchange (prev, (comperand << 16) | (comperand >> 16), comperand) )
+  /// two low shorts of long are swapped, high ones of 64 bits long stay
+  unsigned long value = (unsigned long) comperand;
+  long exchange = (long) ( (value & ~0xffffffffUL) | ( (value & 0xffffUL) << 16) | ( (value >> 16) & 0xffffUL) );
+
+  if (comperand != atomic_compare_exchange (prev, exchange, comperand) )
   { tbrk (); return false; }
 
   return true;
 }
 
 /// CleanUp element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: remove_dead (ptce pelem)
 {
@@ -275,11 +292,7 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
   }
 
   if (pelem->pval)
-  {
-    pelem->pval-> ~Tvalue ();
-
-    allocator.deallocate (pelem->pval), pelem->pval = 0;
-  }
+    free_value (pelem->pval), pelem->pval = 0;
 
   pelem->ref    = 0;
   pelem->lastus = 0;
@@ -292,8 +305,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// ERAS -> FREE. Enable only in ERASE status. If successfull than setup FREE status
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: erase (ptce& pelem)
 {
@@ -309,11 +322,7 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
     atomic_dec (& use_counter);
 
     if (locp)
-    {
-      locp-> ~Tvalue ();
-
-      allocator.deallocate (locp), locp = 0;
-    }
+      free_value (locp), locp = 0;
 
     /// Set FREE status
     change_status (pelem, TS_FREE_SIGN, TS_ERAS_SIGN);
@@ -329,8 +338,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// DEAD -> ERAS -> FREE. Return true if erase dead element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: erase_dead (ptce& pelem)
 {
@@ -363,8 +372,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// KILL -> ERAS -> FREE. Return true if erase element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: erase_killed (ptce& pelem)
 {
@@ -388,8 +397,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 /// LIVE -> KILL (-> ERAS -> FREE) || LIVE -> KILL -> DEAD
 /** Set status FREE or DEAD, begin with LIVE status going over KILL and ERAS
   * Return false if pelem biger of top_storage */
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: remove (ptce pelem)
 {
@@ -463,6 +472,16 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
     }
   }
 
+  if (Treclaim :: is_deferred) ///< remover doesn't wait, last reader erases element on release
+  {
+    change_status (pelem, TS_DEAD_SIGN, TS_KILL_SIGN);
+
+    if (erase_dead (pelem) ) ///< readers left before element was marked
+      release_remove (pelem);
+
+    return true;
+  }
+
   /// Cache element's in using, try to wait releasing 
   long retry = TS_SPINLOCK_COUNTER;
 
@@ -496,8 +515,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// Search array element by key & lock it
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: search_by_key (long& pos, ptce& pelem, Tkey key)
 {
@@ -572,8 +591,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// Search array element by hash & lock it
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: search_by_hash (long& pos, ptce& pelem, Thash hash)
 {
@@ -647,22 +666,23 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
   return false;
 }
 
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-timer_cache    <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+timer_cache    <Tkey,       Tvalue,       Thash,       Tallocator,       Treclaim>
 
-:: timer_cache (const ulonglong timeout, long num_elem = 32)
- : cache_timeout (0), storage (0), top_storage (0), use_counter (0), max_elem (0)
+:: timer_cache (const ulonglong timeout, long num_elem)
+ : storage (0), top_storage (0), buble_booster (0), cache_timeout (0), use_counter (0), max_elem (0)
 {
   if (num_elem > 0xFFFF) { brk (); num_elem = 0xFFFF; } ///< Elements are avaibled to processing maximum 0xFFFF (65535). Limited by buble booster.
 
-  storage = allocator.allocate (sizeof (*storage) * num_elem);
+  storage = (ptce) allocator.allocate (sizeof (*storage) * num_elem);
   if (!storage) { brk (); return; }
 
-  buble_booster = allocator.allocate (sizeof (*buble_booster) * num_elem);
+  /// buble_up exchanges by long, tail of array is padded for it
+  buble_booster = (unsigned short*) allocator.allocate (sizeof (*buble_booster) * num_elem + sizeof (long) );
   if (!buble_booster) { brk (); allocator.deallocate (storage), storage = 0; return; }
 
   memset (storage,       0, sizeof (tce)   * num_elem);
-  memset (buble_booster, 0, sizeof (unsigned short) * num_elem);
+  memset (buble_booster, 0, sizeof (unsigned short) * num_elem + sizeof (long) );
 
   ptce p = storage;
 
@@ -677,8 +697,8 @@ timer_cache    <Tkey,       Tvalue,       Thash,       Tallocator>
   max_elem  = num_elem;
 }
 
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-timer_cache    <Tkey,       Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+timer_cache    <Tkey,       Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: ~timer_cache ()
 {
@@ -687,12 +707,12 @@ timer_cache    <Tkey,       Tvalue,       Thash,       Tallocator>
   max_elem = 0;
 
   if (storage)       allocator.deallocate (storage),            storage  = top_storage = 0;
-  if (buble_booster) allocator.deallocate (buble_booster) buble_booster, buble_booster = 0;
+  if (buble_booster) allocator.deallocate (buble_booster),      buble_booster = 0;
 }
 
 /// Insert element in cache & if successfull than lock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: set_at (long& pos, Tkey key, Thash hash, const Tvalue* pvalue)
 {
@@ -815,7 +835,7 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
     buble_up (max_elem - 1);
   }
 
-  Tvalue* pval = allocator.allocate (sizeof (*pval) )
+  Tvalue* pval = (Tvalue*) allocator.allocate (sizeof (*pval) );
 
   /// Allocate new cache element
   if (!pval)
@@ -847,8 +867,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// Look for element in cache by key & if successfull search than lock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: lookup_by_key (long& pos, Tkey key, Tvalue*& pvalue)
 {
@@ -862,8 +882,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// Look for element in cache by keys hash & if successfull search than lock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: lookup_by_key_hash (long& pos, Tkey key, Tvalue*& pvalue)
 {
@@ -878,8 +898,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// Look for element in cache by hash & if successfull search than lock element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: lookup_by_hash (long& pos, Thash hash, Tvalue*& pvalue)
 {
@@ -893,8 +913,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// Remove element from cache by key
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: remove_by_key (Tkey key)
 {
@@ -908,8 +928,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// Remove element from cache by keys hash
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: remove_by_key_hash (Tkey key)
 {
@@ -923,8 +943,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// Remove element from cache by hash
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: remove_by_hash (Thash hash)
 {
@@ -937,14 +957,15 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
   return remove (pos);
 }
 
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-void timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+void timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: remove_all ()
 {
   Tkey key;
   Tvalue* pv;
-  size_t pos = 0, hash;
+  Thash hash;
+  long pos = 0;
 
   if (!start (pos, key, hash, pv))
     return;
@@ -954,8 +975,8 @@ void timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// Doesn't thread safe method, it called from destructor
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-void timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+void timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: remove_all_unsafe ()
 {
@@ -977,8 +998,8 @@ void timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// Next caches enumerating & if failure than unlock last element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: start (long& pos, Tkey& key, Thash& hash, Tvalue*& pvalue)
 {
@@ -1016,8 +1037,8 @@ bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
 }
 
 /// Next caches enumerating & if failure than unlock last element
-template <class Tkey, class Tvalue, class Thash, class Tallocator>
-bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator>
+template <class Tkey, class Tvalue, class Thash, class Tallocator, class Treclaim>
+bool timer_cache <Tkey,     Tvalue,       Thash,       Tallocator,       Treclaim>
 
 :: start (long& pos, Thash hash, Tvalue*& pvalue)
 {
@@ -10,7 +10,8 @@
  *
  *  Classes, methods and structures: \details
  *
- *  Internal: ts_resource_*, ts_spin_*, tstl :: atomic_*
+ *  Internal: ts_resource_*, ts_resource_wait_*, ts_spin_*, tstl :: atomic_*, tstl :: ts_dword, tstl :: tagged_ptr,
+ *            tstl :: bit_scan_reverse, tstl :: bit_scan_forward
  *
  *  TODO:		\todo
  *
@@ -21,6 +22,7 @@
 
 #include "impl/tsdebug.h"
 #include "impl/tssleep.h"
+#include "impl/tsfutex.h"
 
 /// Common locker definition
 #define ts_lock_define(locker) volatile long locker;
@@ -42,6 +44,30 @@
 #define ts_resource_unlock(status) \
 { if (TS_BUSY_SIGN != tstl :: interlocked_compare_exchange ( (long*) & status, TS_FREE_SIGN, TS_BUSY_SIGN) ) { brk (); } }
 
+/// Init waitable fast mutex
+#define ts_resource_wait_lock_init(status)   ts_resource_lock_init (status)
+#define ts_resource_wait_lock_define(status) ts_lock_define (status)
+
+/// Enter to waitable fast mutex. Spins while owner is running (BUSY), parks on locker when waiters exist (WAIT)
+#define ts_resource_wait_lock(status) \
+{ long prev = tstl :: interlocked_compare_exchange ( (long*) & status, TS_BUSY_SIGN, TS_FREE_SIGN); \
+  if (TS_FREE_SIGN != prev && ts_processors_number > 1) \
+  { long counter = TS_SPINLOCK_COUNTER << 1; \
+    while (TS_BUSY_SIGN == status && --counter > 0) { ts_yield_processor (); } \
+    if (TS_FREE_SIGN == status) \
+      prev = tstl :: interlocked_compare_exchange ( (long*) & status, TS_BUSY_SIGN, TS_FREE_SIGN); } \
+  if (TS_FREE_SIGN != prev) \
+  { if (TS_WAIT_SIGN != prev) prev = tstl :: interlocked_exchange ( (long*) & status, TS_WAIT_SIGN); \
+    while (TS_FREE_SIGN != prev) \
+    { tstl :: futex_wait (& status, TS_WAIT_SIGN); \
+      prev = tstl :: interlocked_exchange ( (long*) & status, TS_WAIT_SIGN); } } }
+
+/// Leave waitable fast mutex and wake exactly one parked waiter
+#define ts_resource_wait_unlock(status) \
+{ long prev = tstl :: interlocked_exchange ( (long*) & status, TS_FREE_SIGN); \
+  if (TS_WAIT_SIGN == prev) { tstl :: futex_wake (& status, 1); } \
+  else if (TS_BUSY_SIGN != prev) { brk (); } }
+
 /// Init spin locker
 #define ts_spin_lock_init(spin_lock)   { spin_lock = 0; }
 #define ts_spin_lock_define(spin_lock) ts_lock_define (spin_lock)
@@ -177,19 +203,19 @@ static inline void* interlocked_exchange_pointer (void** destination, void* exch
 namespace tstl {
 
 static inline void atomic_inc (long* addend)
-{ ::InterlockedIncrement (addend); }
+{ InterlockedIncrement (addend); }
 
 static inline void atomic_dec (long* addend)
-{ ::InterlockedDecrement (addend); }
+{ InterlockedDecrement (addend); }
 
 static inline long atomic_inc_return (long* addend)
-{ return ::InterlockedIncrement (addend); }
+{ return InterlockedIncrement (addend); }
 
 static inline long atomic_dec_return (long* addend)
-{ return ::InterlockedDecrement (addend); }
+{ return InterlockedDecrement (addend); }
 
 static inline long atomic_add_return (long* addend, long value)
-{ return ::InterlockedExchangeAdd (addend, value); }
+{ return InterlockedExchangeAdd (addend, value); }
 
 static inline long atomic_exchange (long* destination, long exchange)
 { return interlocked_exchange (destination, exchange); }
@@ -205,4 +231,290 @@ static inline void* atomic_compare_exchange (void** destination, void* exchange,
 
 }; ///< end of tstl namespace
 
+/// Explicit memory order and double width primitives
+#if defined (__GNUC__)
+
+#  define TS_DWORD_ALIGNED __attribute__ ( (aligned (2 * sizeof (long) ) ) )
+#  define TS_CACHE_LINE_ALIGNED __attribute__ ( (aligned (TS_CACHE_LINE_SIZE) ) )
+
+/// cmpxchg16b (cmpxchg8b on 32 bits) is inlined when compiler knows about it (-mcx16),
+/// on x86_64 without -mcx16 it's emitted by inline assembler, other targets need libatomic (-latomic)
+#  if defined (__SIZEOF_INT128__) && (__SIZEOF_LONG__ == 8)
+#    if defined (__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+#      define TS_HAS_LOCK_FREE_DWCAS 1
+#    elif defined (__x86_64__)
+#      define TS_HAS_LOCK_FREE_DWCAS 1
+#      define TS_DWCAS_ASM 1
+#    endif
+#  elif defined (__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8)
+#    define TS_HAS_LOCK_FREE_DWCAS 1
+#  endif
+
+#elif defined (_MSC_VER)
+
+#  include <intrin.h>
+
+#  define TS_DWORD_ALIGNED __declspec (align (2 * sizeof (void*) ) )
+#  define TS_CACHE_LINE_ALIGNED __declspec (align (TS_CACHE_LINE_SIZE) )
+#  define TS_HAS_LOCK_FREE_DWCAS 1
+
+#endif
+
+namespace tstl {
+
+/// Pointer sized half of double width word
+#if defined (_MSC_VER) && defined (_WIN64)
+typedef __int64 ts_word;
+#else
+typedef long    ts_word;
+#endif
+
+/// Double width word, both halves are changed by one atomic_compare_exchange_dw
+typedef struct TS_DWORD_ALIGNED ts_dword
+{
+  ts_word lo;
+  ts_word hi;
+} ts_dword;
+
+/// Pointer with ABA counter, counter is incremented by every successful exchange
+template <class T>
+struct TS_DWORD_ALIGNED tagged_ptr
+{
+  T*      ptr;
+  ts_word tag;
+};
+
+#if defined (__GNUC__)
+
+template <class T> static inline T atomic_load_acquire (const volatile T* source)
+{ return __atomic_load_n (source, __ATOMIC_ACQUIRE); }
+
+template <class T> static inline T atomic_load_relaxed (const volatile T* source)
+{ return __atomic_load_n (source, __ATOMIC_RELAXED); }
+
+template <class T> static inline void atomic_store_release (volatile T* destination, T value)
+{ __atomic_store_n (destination, value, __ATOMIC_RELEASE); }
+
+template <class T> static inline void atomic_store_relaxed (volatile T* destination, T value)
+{ __atomic_store_n (destination, value, __ATOMIC_RELAXED); }
+
+/// Full barrier without any store
+static inline void atomic_fence ()
+{ __atomic_thread_fence (__ATOMIC_SEQ_CST); }
+
+/// Loads before barrier aren't reordered with loads after it
+static inline void atomic_fence_acquire ()
+{ __atomic_thread_fence (__ATOMIC_ACQUIRE); }
+
+/// Compiler doesn't reorder memory accesses over it, processor could
+static inline void atomic_compiler_fence ()
+{ __atomic_signal_fence (__ATOMIC_SEQ_CST); }
+
+static inline void atomic_inc_relaxed (long* addend)
+{ __atomic_add_fetch (addend, 1, __ATOMIC_RELAXED); }
+
+static inline void atomic_dec_relaxed (long* addend)
+{ __atomic_sub_fetch (addend, 1, __ATOMIC_RELAXED); }
+
+/// Compare exchange functions return previous value like atomic_compare_exchange does
+template <class T> static inline T atomic_compare_exchange_acquire (volatile T* destination, T exchange, T comperand)
+{ __atomic_compare_exchange_n (destination, & comperand, exchange, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE); return comperand; }
+
+template <class T> static inline T atomic_compare_exchange_release (volatile T* destination, T exchange, T comperand)
+{ __atomic_compare_exchange_n (destination, & comperand, exchange, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED); return comperand; }
+
+template <class T> static inline T atomic_compare_exchange_relaxed (volatile T* destination, T exchange, T comperand)
+{ __atomic_compare_exchange_n (destination, & comperand, exchange, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED); return comperand; }
+
+template <class T> static inline T atomic_exchange_acq_rel (volatile T* destination, T exchange)
+{ return __atomic_exchange_n (destination, exchange, __ATOMIC_ACQ_REL); }
+
+#  if defined (__SIZEOF_INT128__) && (__SIZEOF_LONG__ == 8)
+typedef unsigned __int128   ts_dword_value;
+#  else
+typedef unsigned long long  ts_dword_value;
+#  endif
+
+/// Double width compare exchange. On fail comperand gets current value of destination.
+static inline bool atomic_compare_exchange_dw (volatile ts_dword* destination, const ts_dword& exchange, ts_dword& comperand)
+{
+#  if defined (TS_DWCAS_ASM)
+  bool result;
+
+  asm volatile ("	lock cmpxchg16b %1\n"
+	"	sete	%0"
+	: "=q" (result), "+m" (* (volatile ts_dword_value*) destination), "+a" (comperand.lo), "+d" (comperand.hi)
+	: "b" (exchange.lo), "c" (exchange.hi)
+	: "memory", "cc");
+
+  return result;
+#  else
+  ts_dword_value* pcomperand = (ts_dword_value*) & comperand;
+  ts_dword_value  exchange_value = * (const ts_dword_value*) & exchange;
+
+#    if defined (TS_HAS_LOCK_FREE_DWCAS)
+  ts_dword_value prev = __sync_val_compare_and_swap ( (volatile ts_dword_value*) destination, *pcomperand, exchange_value);
+
+  if (prev == *pcomperand)
+    return true;
+
+  *pcomperand = prev;
+  return false;
+#    else
+  return __atomic_compare_exchange_n ( (volatile ts_dword_value*) destination, pcomperand, exchange_value,
+                                       false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#    endif
+#  endif
+}
+
+#elif defined (_MSC_VER) ///< x86 and x64 stores are ordered, compiler reordering is enough to prevent
+
+template <class T> static inline T atomic_load_acquire (const volatile T* source)
+{ T value = *source; _ReadWriteBarrier (); return value; }
+
+template <class T> static inline T atomic_load_relaxed (const volatile T* source)
+{ return *source; }
+
+template <class T> static inline void atomic_store_release (volatile T* destination, T value)
+{ _ReadWriteBarrier (); *destination = value; }
+
+template <class T> static inline void atomic_store_relaxed (volatile T* destination, T value)
+{ *destination = value; }
+
+static inline void atomic_fence ()
+{ MemoryBarrier (); }
+
+static inline void atomic_fence_acquire ()
+{ _ReadWriteBarrier (); }
+
+static inline void atomic_compiler_fence ()
+{ _ReadWriteBarrier (); }
+
+static inline void atomic_inc_relaxed (long* addend)
+{ InterlockedIncrement (addend); }
+
+static inline void atomic_dec_relaxed (long* addend)
+{ InterlockedDecrement (addend); }
+
+/// Interlocked instructions are full barriers here
+static inline long atomic_compare_exchange_acquire (volatile long* destination, long exchange, long comperand)
+{ return interlocked_compare_exchange ( (long*) destination, exchange, comperand); }
+
+static inline long atomic_compare_exchange_release (volatile long* destination, long exchange, long comperand)
+{ return interlocked_compare_exchange ( (long*) destination, exchange, comperand); }
+
+static inline long atomic_compare_exchange_relaxed (volatile long* destination, long exchange, long comperand)
+{ return interlocked_compare_exchange ( (long*) destination, exchange, comperand); }
+
+static inline long atomic_exchange_acq_rel (volatile long* destination, long exchange)
+{ return interlocked_exchange ( (long*) destination, exchange); }
+
+template <class T> static inline T* atomic_compare_exchange_acquire (T* volatile* destination, T* exchange, T* comperand)
+{ return (T*) interlocked_compare_exchange_pointer ( (void**) destination, exchange, comperand); }
+
+template <class T> static inline T* atomic_compare_exchange_release (T* volatile* destination, T* exchange, T* comperand)
+{ return (T*) interlocked_compare_exchange_pointer ( (void**) destination, exchange, comperand); }
+
+template <class T> static inline T* atomic_compare_exchange_relaxed (T* volatile* destination, T* exchange, T* comperand)
+{ return (T*) interlocked_compare_exchange_pointer ( (void**) destination, exchange, comperand); }
+
+template <class T> static inline T* atomic_exchange_acq_rel (T* volatile* destination, T* exchange)
+{ return (T*) interlocked_exchange_pointer ( (void**) destination, exchange); }
+
+/// Double width compare exchange. On fail comperand gets current value of destination.
+static inline bool atomic_compare_exchange_dw (volatile ts_dword* destination, const ts_dword& exchange, ts_dword& comperand)
+{
+#  if defined (_WIN64)
+  return 0 != _InterlockedCompareExchange128 ( (volatile __int64*) destination, exchange.hi, exchange.lo, (__int64*) & comperand);
+#  else
+  __int64 prev = * (__int64*) & comperand;
+  __int64 curr = _InterlockedCompareExchange64 ( (volatile __int64*) destination, * (const __int64*) & exchange, prev);
+
+  if (curr == prev)
+    return true;
+
+  * (__int64*) & comperand = curr;
+  return false;
+#  endif
+}
+
+#endif
+
+/// Tagged pointer exchange, tag of exchange value is taken from comperand
+template <class T>
+static inline bool atomic_compare_exchange_tagged (volatile tagged_ptr<T>* destination, T* exchange, tagged_ptr<T>& comperand)
+{
+  tagged_ptr<T> new_value;
+  new_value.ptr = exchange;
+  new_value.tag = comperand.tag + 1;
+
+  return atomic_compare_exchange_dw ( (volatile ts_dword*) destination, * (ts_dword*) & new_value, * (ts_dword*) & comperand);
+}
+
+/// Store-load fence of frequent side of Dekker's pair, rare side calls process_barrier before its load
+/** It's compiler fence only while process barrier works, else it's full fence */
+static inline void atomic_fence_asymmetric ()
+{
+  if (process_barrier_state () > 0)
+    atomic_compiler_fence ();
+  else
+    atomic_fence ();
+}
+
+/// Set bits of mask, returns previous value
+static inline long atomic_or (long* destination, long mask)
+{
+  long prev = *destination, curr = 0;
+
+  while (prev != (curr = atomic_compare_exchange (destination, prev | mask, prev) ) )
+    prev = curr;
+
+  return prev;
+}
+
+/// Keep bits of mask only, returns previous value
+static inline long atomic_and (long* destination, long mask)
+{
+  long prev = *destination, curr = 0;
+
+  while (prev != (curr = atomic_compare_exchange (destination, prev & mask, prev) ) )
+    prev = curr;
+
+  return prev;
+}
+
+/// Number of highest set bit, word isn't 0
+static inline long bit_scan_reverse (unsigned long word)
+{
+#if defined (_MSC_VER)
+  unsigned long index = 0;
+  _BitScanReverse (& index, word);
+  return (long) index;
+#elif defined (__GNUC__)
+  return (long) (sizeof (long) * 8 - 1) - __builtin_clzl (word);
+#else
+  long index = 0;
+  while (word >>= 1) index++;
+  return index;
+#endif
+}
+
+/// Number of lowest set bit, word isn't 0
+static inline long bit_scan_forward (unsigned long word)
+{
+#if defined (_MSC_VER)
+  unsigned long index = 0;
+  _BitScanForward (& index, word);
+  return (long) index;
+#elif defined (__GNUC__)
+  return (long) __builtin_ctzl (word);
+#else
+  long index = 0;
+  while (!(word & 1) ) word >>= 1, index++;
+  return index;
+#endif
+}
+
+}; ///< end of tstl namespace
+
 #endif /* __TSATOMIC_H__ */
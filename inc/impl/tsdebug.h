@@ -17,6 +17,11 @@
 #ifndef __TSDEBUG_H__
 #define __TSDEBUG_H__
 
+/// unistd.h declares brk (void*) of data segment, it's included before brk macro hides it
+#if defined (__unix__) && !defined (__KERNEL__) && !defined (brk)
+#  include <unistd.h>
+#endif
+
 /// break point platform depended macros definition
 #if (defined (DEBUG) || defined (DBG) ) && !defined (brk)
 #  ifndef __GNUC__
@@ -0,0 +1,697 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file tsepoch.hpp
+ *
+ *  Abstract:		\brief Epoch based memory reclamation, retired memory is freed by batches after readers leave.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: allocator, thread_slot, atomic_compare_exchange, atomic_fence, pthread_key_create, FlsAlloc
+ *  Internal: epoch_domain, epoch_guard, wait_reclaim, epoch_reclaim, retire_routine
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __TSEPOCH_HPP__
+#define __TSEPOCH_HPP__
+
+#include "tstl.hpp"
+#include "impl/tsthread.h"
+
+#define TS_EPOCH_SLOTS 64 ///< default number of threads which use domain at same time
+#define TS_EPOCH_BATCH 64 ///< pointers in one bag, collecting is tried by every full bag
+
+/// Slot of thread is kept by thread local key of domain, exit callback of thread gives it back.
+/** Kernel mode hasn't exit callback of thread and current processor is changed by migration,
+  * so threads don't take slots there, enter fails and containers use reference counters. */
+#if defined (TS_HAS_THREADS) && defined (_MSC_VER)
+#  define TS_EPOCH_HAS_SLOTS 1
+#  define TS_EPOCH_EXIT_CALL NTAPI
+typedef DWORD ts_epoch_key;
+#elif defined (TS_HAS_THREADS)
+#  define TS_EPOCH_HAS_SLOTS 1
+#  define TS_EPOCH_EXIT_CALL
+typedef pthread_key_t ts_epoch_key;
+#endif
+
+namespace tstl {
+
+#if defined (TS_EPOCH_HAS_SLOTS)
+
+typedef void (TS_EPOCH_EXIT_CALL *epoch_exit_routine) (void* value);
+
+/// Create thread local key, routine is called by exit of thread which has value
+static inline bool epoch_key_create (ts_epoch_key& key, const epoch_exit_routine routine)
+{
+#  if defined (_MSC_VER)
+  key = FlsAlloc (routine);
+  return FLS_OUT_OF_INDEXES != key;
+#  else
+  return 0 == pthread_key_create (& key, routine);
+#  endif
+}
+
+static inline void epoch_key_delete (ts_epoch_key key)
+{
+#  if defined (_MSC_VER)
+  FlsFree (key); ///< it calls routine for values of alive threads
+#  else
+  pthread_key_delete (key);
+#  endif
+}
+
+static inline void* epoch_key_get (ts_epoch_key key)
+{
+#  if defined (_MSC_VER)
+  return FlsGetValue (key);
+#  else
+  return pthread_getspecific (key);
+#  endif
+}
+
+static inline bool epoch_key_set (ts_epoch_key key, void* value)
+{
+#  if defined (_MSC_VER)
+  return FALSE != FlsSetValue (key, value);
+#  else
+  return 0 == pthread_setspecific (key, value);
+#  endif
+}
+
+#endif ///< TS_EPOCH_HAS_SLOTS
+
+typedef void (*retire_routine) (void* pointer, void* context);
+
+/// Pointer which waits for end of readers
+typedef struct epoch_retired
+{
+  void* pointer;
+  retire_routine routine;
+  void* context;
+} eret, *peret;
+
+/// Batch of retired pointers, epoch is global epoch of last retired pointer
+typedef struct epoch_bag
+{
+  epoch_bag* next; ///< older bag
+  long epoch;
+  long counter;
+  epoch_retired retired [TS_EPOCH_BATCH];
+} ebag, *pebag;
+
+/// Epoch based reclamation domain
+/** Thread enters domain before it reads shared pointers and leaves it after, entered thread
+  * announces global epoch in own slot. Remover unlinks object, retires it into bag of own
+  * slot and goes on without waiting. Global epoch is advanced when every entered thread
+  * announces current one, so bag retired in epoch E is freed when global epoch is E + 2: all
+  * readers which could see object have left. Bags are freed by owner of slot together, so
+  * memory goes back by batches. Slots are taken by threads on first enter or retire, they
+  * live on own cache lines, and enter/leave write own slot only. Slot is given back by detach
+  * or by exit of thread, bags which aren't old enough are left to other threads. Thread
+  * without slot (all slots are taken, kernel mode) isn't entered, its retired pointer goes
+  * into orphans at once, so retire doesn't wait for readers. Quiescent state (QSBR) is
+  * announced by quiescent, thread stays entered but drops pointers read before. */
+template <class Tallocator = allocator, long Tslots = TS_EPOCH_SLOTS>
+
+class epoch_domain
+{
+  typedef struct epoch_slot
+  {
+    volatile long owner; ///< 1 if slot is taken by thread, 0 if slot is free
+    void* domain;        ///< back pointer for exit callback of thread
+    volatile long state; ///< announced epoch * 2 + 1 while owner is entered, 0 out of domain
+    long nesting;
+    long retired_number;
+    long since_collect;
+    pebag bags;          ///< newest bag first
+    pebag spare;         ///< freed bag kept for next retire
+
+    char end_pad [TS_CACHE_LINE_SIZE];
+  } eslot, *peslot;
+
+  char epoch_pad [TS_CACHE_LINE_SIZE];
+  volatile long global_epoch;
+
+  char orphans_pad [TS_CACHE_LINE_SIZE];
+  pebag volatile orphans; ///< bags left by detached threads, chains are pushed and taken all at once
+  long orphan_number;
+
+  char slots_pad [TS_CACHE_LINE_SIZE];
+  eslot slots [Tslots];
+
+  Tallocator allocator;
+
+#if defined (TS_EPOCH_HAS_SLOTS)
+  ts_epoch_key slot_key;
+#endif
+  bool has_key;
+
+  /// Slot of calling thread, free slot is taken if claim is set
+  peslot this_slot (const bool claim = true);
+
+  /// Give slot back, retired pointers which aren't freed go to orphans
+  void release_slot (peslot ps);
+
+#if defined (TS_EPOCH_HAS_SLOTS)
+  /// Exit callback of thread which has slot
+  static void TS_EPOCH_EXIT_CALL thread_exit (void* value)
+  {
+    peslot ps = (peslot) value;
+    if (ps && ps->domain) ( (epoch_domain*) ps->domain)->release_slot (ps);
+  }
+#endif
+
+  /// Advance global epoch if every entered thread announces it
+  bool try_advance ();
+
+  /// Wait for two epochs, it's used if there isn't memory for bag only
+  void synchronize ();
+
+  /// Retire pointer of thread without slot into orphans
+  bool retire_orphan (void* pointer, const retire_routine routine, void* context);
+
+  /// Free bags of slot which are old enough
+  void collect (peslot ps);
+
+  /// Free all pointers of bags chain, empty bag is kept as spare of slot if it's given
+  long free_bags (peslot ps, pebag pb);
+
+  /// Push chain of bags into orphans
+  void push_orphans (pebag first, pebag last);
+
+  /// Free orphan bags which are old enough
+  void collect_orphans (const long epoch);
+
+public:
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  epoch_domain () : global_epoch (1), orphans (0), orphan_number (0), has_key (false)
+  {
+    memset (slots, 0, sizeof (slots) );
+
+    for (long i = 0; i < Tslots; i++)
+      slots [i].domain = this;
+
+#if defined (TS_EPOCH_HAS_SLOTS)
+    has_key = epoch_key_create (slot_key, thread_exit);
+    if (!has_key) { brk (); } ///< threads work without slots
+#endif
+  }
+
+  /// Frees all retired pointers, there shouldn't be entered threads
+  ~epoch_domain ();
+
+  long get_epoch () const
+  { return atomic_load_acquire (& global_epoch); }
+
+  /// Get statistic about retired and not freed pointers
+  long get_stat () const
+  {
+    long retired = atomic_load_acquire (& orphan_number);
+
+    for (long i = 0; i < Tslots; i++)
+      retired += slots [i].retired_number;
+
+    return retired;
+  }
+
+  /// Enter domain, pointers read after it are valid till leave. Enter could be nested.
+  /** \return false if thread hasn't slot, caller protects pointers by other way */
+  bool enter ();
+
+  void leave ();
+
+  /// Announce quiescent state of entered thread, pointers read before aren't used more
+  void quiescent ();
+
+  /// Free pointer by routine (pointer, context) after all entered threads leave domain
+  /** It doesn't wait for readers, it frees old bags of calling thread by every full bag.
+    * It waits for two epochs only if there isn't memory for bag. */
+  bool retire (void* pointer, const retire_routine routine, void* context = 0);
+
+  /// Try to free retired pointers of calling thread now
+  void collect ()
+  {
+    peslot ps = this_slot ();
+    if (ps) collect (ps);
+  }
+
+  /// Give slot of calling thread back before exit of thread
+  void detach ();
+};
+
+/// Enter domain in constructor and leave it in destructor
+template <class Tdomain>
+
+class epoch_guard
+{
+  Tdomain& domain;
+  const bool entered;
+
+public:
+  epoch_guard (Tdomain& in_domain) : domain (in_domain), entered (in_domain.enter () ) {}
+
+  ~epoch_guard ()
+  { if (entered) domain.leave (); }
+};
+
+/// Reclamation policy of containers, remover waits for readers and frees memory at once
+struct wait_reclaim
+{
+  enum { is_deferred = 0 };
+
+  static bool enter ()
+  { return true; }
+
+  static void leave () {}
+
+  static bool retire (void* pointer, const retire_routine routine, void* context = 0)
+  { routine (pointer, context); return true; }
+};
+
+/// Reclamation policy of containers, removed memory is retired into shared epoch domain
+/** Remover doesn't wait, readers are protected by enter/leave of container. Domain is one for
+  * all containers with same policy, it's made on first use. */
+template <class Tdomain = epoch_domain <> >
+struct epoch_reclaim
+{
+  enum { is_deferred = 1 };
+
+  static Tdomain& domain ()
+  {
+    static Tdomain shared_domain;
+    return shared_domain;
+  }
+
+  static bool enter ()
+  { return domain ().enter (); }
+
+  static void leave ()
+  { domain ().leave (); }
+
+  static bool retire (void* pointer, const retire_routine routine, void* context = 0)
+  { return domain ().retire (pointer, routine, context); }
+};
+
+/// Slot of calling thread, free slot is taken if claim is set
+template <class Tallocator, long Tslots>
+typename epoch_domain <Tallocator, Tslots> :: peslot epoch_domain <Tallocator, Tslots>
+
+:: this_slot (const bool claim)
+{
+#if defined (TS_EPOCH_HAS_SLOTS)
+  if (!has_key)
+    return 0;
+
+  peslot ps = (peslot) epoch_key_get (slot_key);
+
+  if (ps || !claim)
+    return ps;
+
+  long first = thread_slot () % Tslots; ///< threads look for free slot from different ones
+
+  for (long i = 0; i < Tslots; i++)
+  {
+    ps = & slots [(first + i) % Tslots];
+
+    if (atomic_load_acquire (& ps->owner)
+     || 0 != atomic_compare_exchange ( (long*) & ps->owner, 1, 0) )
+      continue;
+
+    if (epoch_key_set (slot_key, ps) )
+      return ps;
+
+    atomic_store_release (& ps->owner, 0L);
+    break;
+  }
+#endif
+
+  return 0;
+}
+
+/// Give slot back, retired pointers which aren't freed go to orphans
+template <class Tallocator, long Tslots>
+void epoch_domain <Tallocator, Tslots>
+
+:: release_slot (peslot ps)
+{
+  if (ps->nesting) ///< thread exits inside of domain
+  {
+    brk ();
+    ps->nesting = 0;
+    atomic_store_release (& ps->state, 0L);
+  }
+
+  collect (ps);
+
+  if (ps->bags) ///< readers are still in epoch of these bags
+  {
+    pebag last = ps->bags;
+
+    while (last->next)
+      last = last->next;
+
+    atomic_add_return (& orphan_number, ps->retired_number);
+    push_orphans (ps->bags, last);
+
+    ps->bags = 0, ps->retired_number = 0;
+  }
+
+  if (ps->spare) { allocator.deallocate (ps->spare), ps->spare = 0; }
+
+  ps->since_collect = 0;
+
+  atomic_store_release (& ps->owner, 0L);
+}
+
+/// Advance global epoch if every entered thread announces it
+template <class Tallocator, long Tslots>
+bool epoch_domain <Tallocator, Tslots>
+
+:: try_advance ()
+{
+  long epoch = atomic_load_acquire (& global_epoch);
+
+  atomic_fence (); ///< retired objects are unlinked before slots are read
+
+  for (long i = 0; i < Tslots; i++)
+  {
+    long state = atomic_load_acquire (& slots [i].state);
+
+    if ( (state & 1) && (state >> 1) != epoch) ///< entered thread could read objects of previous epoch
+      return false;
+  }
+
+  return epoch == atomic_compare_exchange ( (long*) & global_epoch, epoch + 1, epoch);
+}
+
+/// Wait for two epochs, it's used if there isn't memory for bag only
+template <class Tallocator, long Tslots>
+void epoch_domain <Tallocator, Tslots>
+
+:: synchronize ()
+{
+  long target = atomic_load_acquire (& global_epoch) + 2;
+
+  while (atomic_load_acquire (& global_epoch) - target < 0)
+    if (!try_advance () )
+      ts_sleep (TS_SPINLOCK_SLEEP_TIME);
+}
+
+/// Free all pointers of bags chain, empty bag is kept as spare of slot if it's given
+template <class Tallocator, long Tslots>
+long epoch_domain <Tallocator, Tslots>
+
+:: free_bags (peslot ps, pebag pb)
+{
+  long freed = 0;
+
+  while (pb)
+  {
+    pebag next = pb->next;
+
+    for (long i = 0; i < pb->counter; i++)
+      pb->retired [i].routine (pb->retired [i].pointer, pb->retired [i].context);
+
+    freed += pb->counter;
+
+    if (ps && !ps->spare)
+      pb->counter = 0, pb->next = 0, ps->spare = pb;
+    else
+      allocator.deallocate (pb);
+
+    pb = next;
+  }
+
+  return freed;
+}
+
+/// Free bags of slot which are old enough
+template <class Tallocator, long Tslots>
+void epoch_domain <Tallocator, Tslots>
+
+:: collect (peslot ps)
+{
+  ps->since_collect = 0;
+
+  try_advance ();
+
+  long epoch = atomic_load_acquire (& global_epoch);
+
+  /// bags are sorted by epoch, first old enough bag is followed by older ones
+  pebag* link = & ps->bags;
+
+  while (*link && epoch - (*link)->epoch < 2)
+    link = & (*link)->next;
+
+  pebag pb = *link;
+  *link = 0;
+
+  ps->retired_number -= free_bags (ps, pb);
+
+  collect_orphans (epoch);
+}
+
+/// Push chain of bags into orphans
+template <class Tallocator, long Tslots>
+void epoch_domain <Tallocator, Tslots>
+
+:: push_orphans (pebag first, pebag last)
+{
+  for (;;)
+  {
+    pebag head = atomic_load_acquire (& orphans);
+
+    last->next = head;
+
+    if (head == atomic_compare_exchange ( (void**) & orphans, first, head) )
+      return;
+  }
+}
+
+/// Free orphan bags which are old enough
+template <class Tallocator, long Tslots>
+void epoch_domain <Tallocator, Tslots>
+
+:: collect_orphans (const long epoch)
+{
+  if (!atomic_load_acquire (& orphans) )
+    return;
+
+  pebag pb = (pebag) atomic_exchange ( (void**) & orphans, 0);
+  pebag old = 0, first = 0, last = 0;
+
+  while (pb) ///< chain isn't sorted by epoch, every bag is checked
+  {
+    pebag next = pb->next;
+
+    if (epoch - pb->epoch >= 2)
+      pb->next = old, old = pb;
+    else
+    {
+      pb->next = first, first = pb;
+      if (!last) last = pb;
+    }
+
+    pb = next;
+  }
+
+  if (first)
+    push_orphans (first, last);
+
+  atomic_add_return (& orphan_number, - free_bags (0, old) );
+}
+
+template <class Tallocator, long Tslots>
+epoch_domain    <Tallocator, Tslots>
+
+:: ~epoch_domain ()
+{
+#if defined (TS_EPOCH_HAS_SLOTS)
+  if (has_key) epoch_key_delete (slot_key), has_key = false;
+#endif
+
+  for (long i = 0; i < Tslots; i++)
+  {
+    peslot ps = & slots [i];
+
+    if (ps->nesting) { brk (); }
+
+    free_bags (ps, ps->bags), ps->bags = 0;
+
+    if (ps->spare) { allocator.deallocate (ps->spare), ps->spare = 0; }
+
+    ps->retired_number = 0;
+  }
+
+  free_bags (0, orphans), orphans = 0, orphan_number = 0;
+}
+
+/// Enter domain, pointers read after it are valid till leave. Enter could be nested.
+/** \return false if thread hasn't slot, caller protects pointers by other way */
+template <class Tallocator, long Tslots>
+bool epoch_domain <Tallocator, Tslots>
+
+:: enter ()
+{
+  peslot ps = this_slot ();
+  if (!ps) return false; ///< all slots are taken or it's kernel mode
+
+  if (ps->nesting++)
+    return true;
+
+  atomic_store_relaxed (& ps->state, atomic_load_acquire (& global_epoch) * 2 + 1);
+
+  atomic_fence (); ///< announced epoch is visible before shared pointers are read
+  return true;
+}
+
+template <class Tallocator, long Tslots>
+void epoch_domain <Tallocator, Tslots>
+
+:: leave ()
+{
+  peslot ps = this_slot (false);
+  if (!ps || !ps->nesting) { brk (); return; }
+
+  if (--ps->nesting)
+    return;
+
+  atomic_store_release (& ps->state, 0L); ///< reads of shared pointers are done before
+}
+
+/// Announce quiescent state of entered thread, pointers read before aren't used more
+template <class Tallocator, long Tslots>
+void epoch_domain <Tallocator, Tslots>
+
+:: quiescent ()
+{
+  peslot ps = this_slot (false);
+  if (!ps || !ps->nesting) { brk (); return; }
+
+  atomic_store_release (& ps->state, atomic_load_acquire (& global_epoch) * 2 + 1);
+
+  atomic_fence ();
+}
+
+/// Free pointer by routine (pointer, context) after all entered threads leave domain
+/** It doesn't wait for readers, it frees old bags of calling thread by every full bag. */
+template <class Tallocator, long Tslots>
+bool epoch_domain <Tallocator, Tslots>
+
+:: retire (void* pointer, const retire_routine routine, void* context)
+{
+  if (!pointer || !routine) { brk (); return false; }
+
+  peslot ps = this_slot ();
+
+  if (!ps) ///< all slots are taken or it's kernel mode
+    return retire_orphan (pointer, routine, context);
+
+  atomic_fence (); ///< pointer is unlinked before global epoch is read
+
+  long epoch = atomic_load_acquire (& global_epoch);
+
+  pebag pb = ps->bags;
+
+  if (!pb || TS_EPOCH_BATCH == pb->counter)
+  {
+    pb = ps->spare ? ps->spare : (pebag) allocator.allocate (sizeof (*pb) );
+
+    if (!pb) ///< there isn't memory for bag
+    {
+      brk ();
+      synchronize ();
+      routine (pointer, context);
+      return true;
+    }
+
+    if (pb == ps->spare)
+      ps->spare = 0;
+
+    pb->next = ps->bags, pb->counter = 0;
+    ps->bags = pb;
+  }
+
+  pb->epoch = epoch; ///< bag is freed by epoch of its last pointer
+
+  pb->retired [pb->counter].pointer = pointer;
+  pb->retired [pb->counter].routine = routine;
+  pb->retired [pb->counter].context = context;
+  pb->counter++;
+
+  ps->retired_number++;
+
+  if (++ps->since_collect >= TS_EPOCH_BATCH)
+    collect (ps);
+
+  return true;
+}
+
+/// Retire pointer of thread without slot into orphans
+template <class Tallocator, long Tslots>
+bool epoch_domain <Tallocator, Tslots>
+
+:: retire_orphan (void* pointer, const retire_routine routine, void* context)
+{
+  /// bag of one pointer, it's freed by deallocate of orphans
+  pebag pb = (pebag) allocator.allocate (sizeof (*pb) - sizeof (pb->retired) + sizeof (pb->retired [0]) );
+
+  if (!pb) ///< there isn't memory for bag
+  {
+    brk ();
+    synchronize ();
+    routine (pointer, context);
+    return true;
+  }
+
+  atomic_fence (); ///< pointer is unlinked before global epoch is read
+
+  pb->next    = 0;
+  pb->epoch   = atomic_load_acquire (& global_epoch);
+  pb->counter = 1;
+
+  pb->retired [0].pointer = pointer;
+  pb->retired [0].routine = routine;
+  pb->retired [0].context = context;
+
+  atomic_inc (& orphan_number);
+  push_orphans (pb, pb);
+
+  try_advance ();
+  collect_orphans (atomic_load_acquire (& global_epoch) );
+  return true;
+}
+
+/// Give slot of calling thread back before exit of thread
+template <class Tallocator, long Tslots>
+void epoch_domain <Tallocator, Tslots>
+
+:: detach ()
+{
+  peslot ps = this_slot (false);
+
+  if (!ps)
+    return;
+
+  if (ps->nesting) { brk (); return; }
+
+#if defined (TS_EPOCH_HAS_SLOTS)
+  epoch_key_set (slot_key, 0);
+#endif
+
+  release_slot (ps);
+}
+
+}; /* end of tstl namespace */
+
+#endif /* __TSEPOCH_HPP__ */
@@ -0,0 +1,150 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file tsevent.hpp
+ *
+ *  Abstract:		\brief Eventcount for blocking waiting on non blocking containers.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: futex_wait, futex_wake, process_barrier, process_barrier_register, monotonic_time
+ *  Internal: eventcount, deadline, ts_event_wait
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __TSEVENT_HPP__
+#define __TSEVENT_HPP__
+
+#include "tstl.hpp"
+
+/// Wait till condition is true or event is closed or timeout expired, rc is last condition value
+/** Condition is checked again after waiter is announced, so notify between check and park isn't lost */
+#define ts_event_wait(event, condition, timeout, rc) \
+{ tstl :: deadline time (timeout); \
+  for (rc = false; !rc;) \
+  { if ( (rc = (condition) ) ) break; \
+    long key = (event).prepare_wait (); \
+    if ( (rc = (condition) ) ) { (event).cancel_wait (); break; } \
+    long left = time.left (); \
+    if (!left || (event).is_closed () ) { (event).cancel_wait (); break; } \
+    (event).wait (key, left); } }
+
+namespace tstl {
+
+/// Eventcount
+/** Waiter takes key by prepare_wait, checks its condition again and parks by wait (key) or
+  * leaves by cancel_wait. Notifier changes condition and calls notify_all, which costs only
+  * load of waiters counter when nobody waits: waiter pays for store-load ordering of both
+  * sides by process barrier (membarrier). Notifier uses full fence only when kernel doesn't
+  * support it. close wakes all waiters forever. */
+class eventcount
+{
+  volatile long epoch;   ///< it's changed by every notify with waiters
+  volatile long waiters;
+  volatile long closed;
+
+public:
+  /// Process barrier is registered before first notify, so notifiers don't pay full fence till first wait
+  eventcount () : epoch (0), waiters (0), closed (0)
+  { process_barrier_register (); }
+
+  /// Announce waiter before last check of condition
+  /** Notifier, which didn't see waiters, made its condition change visible after process barrier */
+  long prepare_wait ()
+  {
+    atomic_inc ( (long*) & waiters);
+    process_barrier ();
+    return atomic_load_acquire (& epoch);
+  }
+
+  /// Condition became true after prepare_wait
+  void cancel_wait ()
+  { atomic_dec ( (long*) & waiters); }
+
+  /// Park till notify_all, close or timeout
+  /** \param timeout is in milliseconds */
+  void wait (long key, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    if (!closed && key == atomic_load_acquire (& epoch) )
+      futex_wait (& epoch, key, timeout);
+
+    atomic_dec ( (long*) & waiters);
+  }
+
+  /// Condition change is visible before waiters are read
+  static void notify_fence ()
+  {
+#if defined (TS_HAS_FUTEX)
+    atomic_fence_asymmetric (); ///< waiter pays by process barrier
+#else
+    atomic_compiler_fence (); ///< waiters don't park, they sleep and check condition again
+#endif
+  }
+
+  /// Wake all waiters if they are
+  void notify_all ()
+  {
+    notify_fence ();
+
+    if (atomic_load_relaxed (& waiters) )
+    {
+      atomic_inc ( (long*) & epoch);
+      futex_wake (& epoch, TS_FUTEX_WAKE_ALL);
+    }
+  }
+
+  /// Wake one waiter if they are, other waiters see changed epoch if they aren't parked yet
+  void notify_one ()
+  {
+    notify_fence ();
+
+    if (atomic_load_relaxed (& waiters) )
+    {
+      atomic_inc ( (long*) & epoch);
+      futex_wake (& epoch, 1);
+    }
+  }
+
+  /// Wake all waiters and don't let them park again
+  void close ()
+  {
+    atomic_exchange ( (long*) & closed, 1);
+    atomic_inc ( (long*) & epoch);
+    futex_wake (& epoch, TS_FUTEX_WAKE_ALL);
+  }
+
+  bool is_closed () const
+  { return 0 != closed; }
+};
+
+/// Rest of timeout of waiting operation
+class deadline
+{
+  ulonglong end;
+  const bool infinite;
+
+public:
+  /** \param timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever */
+  deadline (long timeout) : end (0), infinite (timeout < 0)
+  { if (!infinite) end = monotonic_time () + timeout; }
+
+  /// Milliseconds left, 0 means expired
+  long left () const
+  {
+    if (infinite)
+      return TS_INFINITE_TIMEOUT;
+
+    ulonglong now = monotonic_time ();
+
+    return now >= end ? 0 : (long) (end - now);
+  }
+};
+
+}; /* end of tstl namespace */
+
+#endif /* __TSEVENT_HPP__ */
@@ -0,0 +1,335 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file tsfutex.h
+ *
+ *  Abstract:		\brief Parking primitives for waitable lockers (Linux futex, WaitOnAddress, kernel semaphores or sleeping fallback).
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Internal: tstl :: futex_wait, tstl :: futex_wake, TS_HAS_FUTEX, TS_FUTEX_WAKE_ALL,
+ *            tstl :: process_barrier, tstl :: process_barrier_register, tstl :: process_barrier_state,
+ *            TS_HAS_PROCESS_BARRIER, tstl :: futex_bucket (kernel mode), tstl :: address_waits (Windows)
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __TSFUTEX_H__
+#define __TSFUTEX_H__
+
+#include "impl/tssleep.h"
+#include "impl/tstime.h"
+
+#define TS_FUTEX_WAKE_ALL 0x7FFFFFFF
+
+#if defined (__linux__) && !defined (__KERNEL__)
+
+#  include <unistd.h>
+#  include <sys/syscall.h>
+#  include <linux/futex.h>
+
+#  define TS_HAS_FUTEX 1
+
+/// membarrier commands, old kernel headers don't know them
+#  if defined (SYS_membarrier)
+#    define TS_HAS_PROCESS_BARRIER 1
+#    define TS_MEMBARRIER_CMD_PRIVATE_EXPEDITED (1 << 3)
+#    define TS_MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED (1 << 4)
+#  endif
+
+namespace tstl {
+
+/// Futex works with 32 bits word, it's low part of long locker
+static inline int* futex_word (volatile long* addr)
+{
+#  if defined (__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  return (int*) addr + (sizeof (long) / sizeof (int) - 1);
+#  else
+  return (int*) addr;
+#  endif
+}
+
+/// Park thread while *addr is equal to value
+/** \param timeout is in milliseconds, thread could be waked up earlier */
+static inline void futex_wait (volatile long* addr, long value, long timeout = TS_INFINITE_TIMEOUT)
+{
+  struct timespec ts;
+  ts.tv_sec  = timeout / 1000;
+  ts.tv_nsec = (timeout % 1000) * 1000000;
+
+  syscall (SYS_futex, futex_word (addr), FUTEX_WAIT_PRIVATE, (int) value, timeout < 0 ? 0 : & ts, 0, 0);
+}
+
+/// Wake up to waiters threads parked on addr
+static inline void futex_wake (volatile long* addr, long waiters)
+{ syscall (SYS_futex, futex_word (addr), FUTEX_WAKE_PRIVATE, (int) waiters, 0, 0, 0); }
+
+/// State of process barrier: 0 isn't registered yet, 1 works, -1 isn't supported by kernel
+/** It isn't static, so all translation units share one state. */
+inline volatile long& process_barrier_state ()
+{
+  static volatile long state = 0;
+  return state;
+}
+
+/// Register process for expedited membarrier, it's called by constructor of eventcount
+/** Frequent side pays full fence till registration, so it's done before first notify,
+  * not by first waiter. \return false if kernel doesn't support membarrier */
+inline bool process_barrier_register ()
+{
+  volatile long& state = process_barrier_state ();
+
+#  if defined (TS_HAS_PROCESS_BARRIER)
+  if (!state)
+    state = 0 == syscall (SYS_membarrier, TS_MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) ? 1 : -1;
+#  else
+  state = -1;
+#  endif
+
+  return state > 0;
+}
+
+/// Full barrier on all running threads of process, it's paid by rare side of Dekker's pair
+/** Frequent side needs only compiler fence while process_barrier_state is positive.
+  * \return false if kernel doesn't support membarrier, then frequent side needs full fence */
+inline bool process_barrier ()
+{
+#  if defined (TS_HAS_PROCESS_BARRIER)
+  return process_barrier_register () && 0 == syscall (SYS_membarrier, TS_MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+#  else
+  return false;
+#  endif
+}
+
+}; ///< end of tstl namespace
+
+#elif defined (_NTDDK_)
+
+#  define TS_HAS_FUTEX 1
+#  define TS_FUTEX_BUCKETS 64 ///< addresses are hashed to buckets of waiters
+
+namespace tstl {
+
+/// Parked waiters of addresses of bucket, permits of semaphore and waiters are parked threads
+typedef struct futex_bucket
+{
+  KSPIN_LOCK lock;
+  KSEMAPHORE semaphore;
+  long waiters;
+} fb, *pfb;
+
+/// Bucket of address, buckets are initialized by first call
+inline pfb futex_bucket_of (volatile long* addr)
+{
+  static fb buckets [TS_FUTEX_BUCKETS];
+  static volatile long state = 0; ///< 0 isn't initialized, 1 is initialized by other thread, 2 is ready
+
+  if (2 != state)
+  {
+    if (0 == InterlockedCompareExchange ( (long*) & state, 1, 0) )
+    {
+      for (long i = 0; i < TS_FUTEX_BUCKETS; i++)
+      {
+        KeInitializeSpinLock (& buckets [i].lock);
+        KeInitializeSemaphore (& buckets [i].semaphore, 0, MAXLONG);
+        buckets [i].waiters = 0;
+      }
+
+      InterlockedExchange ( (long*) & state, 2);
+    }
+    else
+    {
+      while (2 != state)
+        ts_yield_processor ();
+    }
+  }
+
+  return & buckets [ ( (size_t) addr / sizeof (long) ) % TS_FUTEX_BUCKETS];
+}
+
+/// Park thread while *addr is equal to value, addr must be in non paged memory
+/** Value is checked under lock of bucket, so wake after change of value isn't lost.
+  * \param timeout is in milliseconds, thread could be waked up earlier */
+static inline void futex_wait (volatile long* addr, long value, long timeout = TS_INFINITE_TIMEOUT)
+{
+  pfb pb = futex_bucket_of (addr);
+  KIRQL irql;
+
+  KeAcquireSpinLock (& pb->lock, & irql);
+
+  if (*addr != value || !timeout)
+  { KeReleaseSpinLock (& pb->lock, irql); return; }
+
+  pb->waiters++;
+  KeReleaseSpinLock (& pb->lock, irql);
+
+  LARGE_INTEGER due;
+  due.QuadPart = (LONGLONG) timeout * -10000; ///< relative time in 100 ns
+
+  if (STATUS_TIMEOUT != KeWaitForSingleObject (& pb->semaphore, Executive, KernelMode, FALSE, timeout < 0 ? 0 : & due) )
+    return;
+
+  /// waker could give permit after timeout, thread takes back one place, waiter or permit
+  KeAcquireSpinLock (& pb->lock, & irql);
+
+  if (pb->waiters > 0)
+    pb->waiters--;
+  else
+  {
+    due.QuadPart = 0;
+    KeWaitForSingleObject (& pb->semaphore, Executive, KernelMode, FALSE, & due);
+  }
+
+  KeReleaseSpinLock (& pb->lock, irql);
+}
+
+/// Wake threads parked on addr, all waiters of bucket are waked, waiters of other addresses check their values again
+static inline void futex_wake (volatile long* addr, long)
+{
+  pfb pb = futex_bucket_of (addr);
+  KIRQL irql;
+
+  KeAcquireSpinLock (& pb->lock, & irql);
+
+  long waiters = pb->waiters;
+  pb->waiters = 0;
+
+  if (waiters)
+    KeReleaseSemaphore (& pb->semaphore, IO_NO_INCREMENT, waiters, FALSE);
+
+  KeReleaseSpinLock (& pb->lock, irql);
+}
+
+/// Process barrier isn't used in kernel mode, frequent side of Dekker's pair uses full fence
+static inline bool process_barrier ()
+{ return false; }
+
+static inline bool process_barrier_register ()
+{ return false; }
+
+static inline long process_barrier_state ()
+{ return -1; }
+
+}; ///< end of tstl namespace
+
+#elif defined (_WIN32)
+
+#  define TS_HAS_FUTEX 1
+
+namespace tstl {
+
+typedef BOOL (WINAPI *wait_on_address_routine) (volatile VOID* address, PVOID compare, SIZE_T size, DWORD timeout);
+typedef VOID (WINAPI *wake_by_address_routine) (PVOID address);
+typedef VOID (WINAPI *flush_write_buffers_routine) ();
+
+/// WaitOnAddress family (Windows 8) and FlushProcessWriteBuffers (Vista) are looked up once
+/** Older Windows don't have them, then waiters sleep and notifiers use full fence. */
+typedef struct address_waits
+{
+  wait_on_address_routine wait;
+  wake_by_address_routine wake_single;
+  wake_by_address_routine wake_all;
+  flush_write_buffers_routine flush;
+  volatile long state; ///< 0 isn't looked up, 1 waits are there, -1 they aren't there
+} aw, *paw;
+
+inline paw address_waits_routines ()
+{
+  static aw routines; ///< zero initialized, any thread could look up same routines
+
+  if (!routines.state)
+  {
+    HMODULE base   = GetModuleHandleA ("kernelbase.dll");
+    HMODULE kernel = GetModuleHandleA ("kernel32.dll");
+
+    routines.wait        = base ? (wait_on_address_routine) GetProcAddress (base, "WaitOnAddress") : 0;
+    routines.wake_single = base ? (wake_by_address_routine) GetProcAddress (base, "WakeByAddressSingle") : 0;
+    routines.wake_all    = base ? (wake_by_address_routine) GetProcAddress (base, "WakeByAddressAll") : 0;
+    routines.flush       = kernel ? (flush_write_buffers_routine) GetProcAddress (kernel, "FlushProcessWriteBuffers") : 0;
+
+    MemoryBarrier (); ///< routines are visible before state
+    routines.state = routines.wait && routines.wake_single && routines.wake_all ? 1 : -1;
+  }
+
+  return & routines;
+}
+
+/// Park thread while *addr is equal to value
+/** \param timeout is in milliseconds, thread could be waked up earlier */
+static inline void futex_wait (volatile long* addr, long value, long timeout = TS_INFINITE_TIMEOUT)
+{
+  paw pr = address_waits_routines ();
+
+  if (pr->state > 0)
+    pr->wait (addr, & value, sizeof (long), timeout < 0 ? INFINITE : (DWORD) timeout);
+  else if (*addr == value && timeout)
+    ts_sleep (TS_SPINLOCK_SLEEP_TIME);
+}
+
+/// Wake up to waiters threads parked on addr
+static inline void futex_wake (volatile long* addr, long waiters)
+{
+  paw pr = address_waits_routines ();
+
+  if (pr->state <= 0)
+    return; ///< waiters sleep and check value again
+
+  if (1 == waiters)
+    pr->wake_single ( (PVOID) addr);
+  else
+    pr->wake_all ( (PVOID) addr);
+}
+
+/// State of process barrier: 0 isn't looked up yet, 1 works, -1 isn't supported by system
+inline long process_barrier_state ()
+{
+  paw pr = address_waits_routines ();
+  return pr->flush && pr->state > 0 ? 1 : -1;
+}
+
+/// FlushProcessWriteBuffers is full barrier on all running threads of process
+inline bool process_barrier_register ()
+{ return process_barrier_state () > 0; }
+
+/// Full barrier on all running threads of process, it's paid by rare side of Dekker's pair
+inline bool process_barrier ()
+{
+  if (!process_barrier_register () )
+    return false;
+
+  address_waits_routines ()->flush ();
+  return true;
+}
+
+}; ///< end of tstl namespace
+
+#else ///< there isn't futex, waiters sleep like ts_resource_lock does
+
+namespace tstl {
+
+static inline void futex_wait (volatile long* addr, long value, long timeout = TS_INFINITE_TIMEOUT)
+{ if (*addr == value && timeout) { ts_sleep (TS_SPINLOCK_SLEEP_TIME); } }
+
+static inline void futex_wake (volatile long* addr, long waiters)
+{ volatile long* unused_addr = addr; long unused_waiters = waiters; }
+
+/// Waiters don't park, so lost wake up costs one sleep and any fence isn't needed
+static inline bool process_barrier ()
+{ return false; }
+
+static inline bool process_barrier_register ()
+{ return false; }
+
+/// Process barrier isn't supported here, frequent side of Dekker's pair uses full fence
+static inline long process_barrier_state ()
+{ return -1; }
+
+}; ///< end of tstl namespace
+
+#endif ///< __linux__ && !__KERNEL__, _NTDDK_, _WIN32
+
+#endif /* __TSFUTEX_H__ */
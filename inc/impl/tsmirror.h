@@ -0,0 +1,146 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file tsmirror.h
+ *
+ *  Abstract:		\brief Mirrored storage, same memory is mapped twice back to back.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Internal: tstl :: mirror_page_size, tstl :: mirror_allocate, tstl :: mirror_deallocate, TS_HAS_MIRROR
+ *
+ *  TODO:		\todo port against kernel mode and mach vm_remap
+ *
+ *********************************************************************************************************/
+
+#ifndef __TSMIRROR_H__
+#define __TSMIRROR_H__
+
+#define TS_MIRROR_TRY_COUNTER 8
+
+#if (defined (__linux__) || defined (__FreeBSD__)) && !defined (__KERNEL__)
+
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+
+#  if defined (SYS_memfd_create) || defined (SHM_ANON)
+#    define TS_HAS_MIRROR 1
+#  endif
+
+#elif defined (_WIN32) && !defined (_NTDDK_)
+
+#  define TS_HAS_MIRROR 1
+
+#endif
+
+namespace tstl {
+
+#if defined (TS_HAS_MIRROR) && !defined (_WIN32)
+
+/// Mirrored storage size must be multiple of it
+static inline size_t mirror_page_size ()
+{ return (size_t) sysconf (_SC_PAGESIZE); }
+
+/// Map size bytes of anonymous file twice back to back
+/** \param size is multiple of mirror_page_size
+  * \return begin of 2 * size bytes region or 0 */
+static inline void* mirror_allocate (const size_t size)
+{
+#  if defined (SYS_memfd_create)
+  int fd = (int) syscall (SYS_memfd_create, "tstl_mirror", 0);
+#  else
+  int fd = shm_open (SHM_ANON, O_RDWR, 0600);
+#  endif
+
+  if (fd < 0)
+    return 0;
+
+  if (ftruncate (fd, size) )
+  { ::close (fd); return 0; }
+
+  /// reserve address space for both views
+  char* p = (char*) mmap (0, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (MAP_FAILED == p)
+  { ::close (fd); return 0; }
+
+  if (MAP_FAILED == mmap (p,        size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0)
+   || MAP_FAILED == mmap (p + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) )
+  { munmap (p, 2 * size); ::close (fd); return 0; }
+
+  ::close (fd); ///< views keep file alive
+
+  return p;
+}
+
+static inline void mirror_deallocate (void* p, const size_t size)
+{ munmap (p, 2 * size); }
+
+#elif defined (TS_HAS_MIRROR) ///< _WIN32
+
+/// Mirrored storage size must be multiple of it
+static inline size_t mirror_page_size ()
+{ SYSTEM_INFO si; GetSystemInfo (& si); return (size_t) si.dwAllocationGranularity; }
+
+/// Map size bytes of paging file section twice back to back
+/** \param size is multiple of mirror_page_size
+  * \return begin of 2 * size bytes region or 0 */
+static inline void* mirror_allocate (const size_t size)
+{
+  HANDLE mapping = CreateFileMapping (INVALID_HANDLE_VALUE, 0, PAGE_READWRITE,
+                                      (DWORD) ( (unsigned __int64) size >> 32), (DWORD) size, 0);
+  if (!mapping)
+    return 0;
+
+  char* p = 0;
+
+  for (long i = 0; !p && i < TS_MIRROR_TRY_COUNTER; i++)
+  { /// find free address space, other thread could take it before views are mapped
+    char* base = (char*) VirtualAlloc (0, 2 * size, MEM_RESERVE, PAGE_NOACCESS);
+
+    if (!base)
+      break;
+
+    VirtualFree (base, 0, MEM_RELEASE);
+
+    if (base != MapViewOfFileEx (mapping, FILE_MAP_ALL_ACCESS, 0, 0, size, base) )
+      continue;
+
+    if (base + size != MapViewOfFileEx (mapping, FILE_MAP_ALL_ACCESS, 0, 0, size, base + size) )
+    { UnmapViewOfFile (base); continue; }
+
+    p = base;
+  }
+
+  CloseHandle (mapping); ///< views keep section alive
+
+  return p;
+}
+
+static inline void mirror_deallocate (void* p, const size_t size)
+{
+  UnmapViewOfFile ( (char*) p + size);
+  UnmapViewOfFile (p);
+}
+
+#else ///< there isn't mirrored storage, callers use ordinary one
+
+static inline size_t mirror_page_size ()
+{ return 0; }
+
+static inline void* mirror_allocate (const size_t size)
+{ size_t unused_size = size; return 0; }
+
+static inline void mirror_deallocate (void* p, const size_t size)
+{ void* unused_p = p; size_t unused_size = size; }
+
+#endif ///< TS_HAS_MIRROR
+
+}; ///< end of tstl namespace
+
+#endif /* __TSMIRROR_H__ */
@@ -0,0 +1,161 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file tsnuma.h
+ *
+ *  Abstract:		\brief NUMA nodes, node of calling thread and memory placed on node.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Internal: tstl :: numa_nodes_number, tstl :: current_numa_node, tstl :: numa_allocate,
+ *            tstl :: numa_deallocate, TS_HAS_NUMA, TS_ANY_NUMA_NODE
+ *
+ *  TODO:		\todo port against kernel mode
+ *
+ *********************************************************************************************************/
+
+#ifndef __TSNUMA_H__
+#define __TSNUMA_H__
+
+#define TS_ANY_NUMA_NODE  (-1L)
+#define TS_MAX_NUMA_NODES 8
+#define TS_MPOL_PREFERRED 1   ///< mbind mode, pages go to other node when preferred one is full
+#define TS_NUMA_NODE_REFRESH 0x100 ///< calls of current_numa_node between checks of node of thread
+
+#include "impl/tsthread.h"
+
+#if defined (__linux__) && !defined (__KERNEL__)
+
+#  include <stdio.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+
+#  if defined (SYS_mbind) && defined (SYS_getcpu)
+#    define TS_HAS_NUMA 1
+#  endif
+
+#elif defined (_WIN32) && !defined (_NTDDK_)
+
+#  define TS_HAS_NUMA 1
+
+#endif
+
+namespace tstl {
+
+#if defined (TS_HAS_NUMA) && !defined (_WIN32)
+
+/// Number of nodes, it's 1 on not NUMA machine
+static inline long numa_nodes_number ()
+{
+  long number = 0;
+
+  for (; number < TS_MAX_NUMA_NODES; number++)
+  {
+    char path [64];
+    snprintf (path, sizeof (path), "/sys/devices/system/node/node%ld", number);
+
+    if (access (path, F_OK) )
+      break;
+  }
+
+  return number ? number : 1;
+}
+
+/// Node of processor which runs calling thread
+/** getcpu is syscall, so node is kept per thread and it's asked again every TS_NUMA_NODE_REFRESH
+  * calls, migrated thread uses node of previous processor for a while only. */
+inline long current_numa_node ()
+{
+  static ts_thread_local long node  = 0;
+  static ts_thread_local long calls = 0;
+
+  if (calls-- > 0)
+    return node;
+
+  calls = TS_NUMA_NODE_REFRESH;
+
+  unsigned int cpu = 0, current = 0;
+
+  node = syscall (SYS_getcpu, & cpu, & current, 0) ? 0 : (long) current;
+  return node;
+}
+
+/// Map size bytes and bind their pages to node by preferred policy
+/** Policy places pages on node whatever thread touches them first.
+  * \return page aligned memory or 0 if mbind fails, then memory isn't placed on node */
+static inline void* numa_allocate (const size_t size, const long node)
+{
+  void* p = mmap (0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (MAP_FAILED == p)
+    return 0;
+
+  unsigned long mask = 1UL << (node % (sizeof (mask) * 8) );
+
+  if (syscall (SYS_mbind, p, size, TS_MPOL_PREFERRED, & mask, sizeof (mask) * 8, 0) )
+  { munmap (p, size); return 0; }
+
+  return p;
+}
+
+static inline void numa_deallocate (void* p, const size_t size)
+{ munmap (p, size); }
+
+#elif defined (TS_HAS_NUMA) ///< _WIN32
+
+/// Number of nodes, it's 1 on not NUMA machine
+static inline long numa_nodes_number ()
+{
+  ULONG highest = 0;
+
+  if (!GetNumaHighestNodeNumber (& highest) )
+    return 1;
+
+  return highest + 1 < TS_MAX_NUMA_NODES ? (long) highest + 1 : TS_MAX_NUMA_NODES;
+}
+
+/// Node of processor which runs calling thread
+static inline long current_numa_node ()
+{
+  UCHAR node = 0;
+
+  if (!GetNumaProcessorNode ( (UCHAR) GetCurrentProcessorNumber (), & node) )
+    return 0;
+
+  return (long) node;
+}
+
+/// Commit size bytes on node
+/** \return page aligned memory or 0 */
+static inline void* numa_allocate (const size_t size, const long node)
+{
+  return VirtualAllocExNuma (GetCurrentProcess (), 0, size, MEM_RESERVE | MEM_COMMIT,
+                             PAGE_READWRITE, (DWORD) node);
+}
+
+static inline void numa_deallocate (void* p, const size_t size)
+{ size_t unused_size = size; VirtualFree (p, 0, MEM_RELEASE); }
+
+#else ///< there isn't NUMA placement, callers use ordinary memory
+
+static inline long numa_nodes_number ()
+{ return 1; }
+
+static inline long current_numa_node ()
+{ return 0; }
+
+static inline void* numa_allocate (const size_t size, const long node)
+{ size_t unused_size = size; long unused_node = node; return 0; }
+
+static inline void numa_deallocate (void* p, const size_t size)
+{ void* unused_p = p; size_t unused_size = size; }
+
+#endif ///< TS_HAS_NUMA
+
+}; ///< end of tstl namespace
+
+#endif /* __TSNUMA_H__ */
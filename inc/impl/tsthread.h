@@ -0,0 +1,125 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file tsthread.h
+ *
+ *  Abstract:		\brief Thread local storage, thread slot and user mode threads definitions for different platforms.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Internal: ts_thread_local, TS_HAS_THREAD_LOCAL, ts_current_thread, tstl :: thread_slot,
+ *            TS_HAS_THREADS, tstl :: thread_create, tstl :: thread_join
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __TSTHREAD_H__
+#define __TSTHREAD_H__
+
+#include "impl/tsatomic.h"
+
+/// definitions of ts_thread_local, or ts_current_processor and ts_current_thread in kernel mode
+#if defined (_NTDDK_)
+
+#  define ts_current_processor() ( (long) KeGetCurrentProcessorNumber () )
+#  define ts_current_thread()    ( (void*) KeGetCurrentThread () )
+
+#elif defined (_MSC_VER)
+
+#  define TS_HAS_THREAD_LOCAL 1
+#  define ts_thread_local __declspec (thread)
+
+#elif defined (__GNUC__)
+
+#  if defined (__linux__) && (__KERNEL__)
+#    define ts_current_processor() ( (long) smp_processor_id () )
+#    define ts_current_thread()    ( (void*) current )
+#  elif defined (__FreeBSD__) && (__KERNEL__)
+#    define ts_current_processor() ( (long) curcpu )
+#    define ts_current_thread()    ( (void*) curthread )
+#  else
+#    define TS_HAS_THREAD_LOCAL 1
+#    define ts_thread_local __thread
+#  endif
+
+#else
+#  error "Undefied target system!!!"
+#endif
+
+/// definitions of user mode threads, ts_thread_return and TS_THREAD_CALL are signature of thread routine
+#if defined (_MSC_VER) && !defined (_NTDDK_)
+
+#  define TS_HAS_THREADS 1
+#  define TS_THREAD_CALL __stdcall
+
+typedef unsigned long ts_thread_return;
+typedef HANDLE ts_thread_handle;
+
+#elif defined (__GNUC__) && defined (TS_HAS_THREAD_LOCAL) && !defined (__DJGPP__)
+
+#  include <pthread.h>
+
+#  define TS_HAS_THREADS 1
+#  define TS_THREAD_CALL
+
+typedef void* ts_thread_return;
+typedef pthread_t ts_thread_handle;
+
+#endif
+
+namespace tstl {
+
+#if defined (TS_HAS_THREADS)
+
+typedef ts_thread_return (TS_THREAD_CALL *thread_routine) (void* context);
+
+/// Start thread with routine
+static inline bool thread_create (ts_thread_handle& thread, thread_routine routine, void* context)
+{
+#  if defined (_MSC_VER)
+  thread = CreateThread (0, 0, (LPTHREAD_START_ROUTINE) routine, context, 0, 0);
+  return 0 != thread;
+#  else
+  return 0 == pthread_create (& thread, 0, routine, context);
+#  endif
+}
+
+/// Wait for end of thread and free its handle
+static inline void thread_join (ts_thread_handle& thread)
+{
+#  if defined (_MSC_VER)
+  WaitForSingleObject (thread, INFINITE);
+  CloseHandle (thread);
+#  else
+  pthread_join (thread, 0);
+#  endif
+}
+
+#endif ///< TS_HAS_THREADS
+
+/// Small number of calling thread. It's given once at first call of thread, used for striping of shared data.
+/** It isn't static, so all translation units share one slot of thread and one slot_base.
+  * In kernel mode it's number of current processor and it's changed by migration of thread,
+  * so pair of calls must not rely on the same slot. */
+inline long thread_slot ()
+{
+#if defined (TS_HAS_THREAD_LOCAL)
+  static ts_thread_local long slot = 0;
+  static long slot_base = 0;
+
+  if (!slot)
+    slot = atomic_inc_return (& slot_base);
+
+  return slot - 1;
+#else
+  return ts_current_processor ();
+#endif
+}
+
+}; ///< end of tstl namespace
+
+#endif /* __TSTHREAD_H__ */
@@ -0,0 +1,61 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file tstime.h
+ *
+ *  Abstract:		\brief Monotonic time source for timeouts of waiting operations.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Internal: tstl :: monotonic_time, tstl :: ulonglong, TS_INFINITE_TIMEOUT
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __TSTIME_H__
+#define __TSTIME_H__
+
+#define TS_INFINITE_TIMEOUT (-1) ///< timeouts are in milliseconds
+
+#if !defined (_NTDDK_) && !defined (WIN32) && defined (__GNUC__) && !defined (__KERNEL__)
+#  include <time.h>
+#  include <sys/time.h>
+#endif
+
+namespace tstl {
+
+#if defined (__GNUC__)
+typedef unsigned long long ulonglong;
+#elif defined (_MSC_VER)
+typedef unsigned __int64   ulonglong;
+#endif
+
+/// Milliseconds from some moment, it isn't changed by system time setting
+static inline ulonglong monotonic_time ()
+{
+#if defined (_NTDDK_)
+  return KeQueryInterruptTime () / 10000;
+#elif defined (WIN32)
+  return GetTickCount (); ///< it wraps every 49 days, waiters don't wait so long
+#elif defined (__linux__) && (__KERNEL__)
+  return jiffies_to_msecs (jiffies);
+#elif defined (__FreeBSD__) && (__KERNEL__)
+  return (ulonglong) ticks * 1000 / hz;
+#elif defined (CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, & ts);
+  return (ulonglong) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#else
+  struct timeval tv;
+  gettimeofday (& tv, 0);
+  return (ulonglong) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+}; ///< end of tstl namespace
+
+#endif /* __TSTIME_H__ */
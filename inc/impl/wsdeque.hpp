@@ -0,0 +1,177 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file wsdeque.hpp
+ *
+ *  Abstract:		\brief Work stealing deque (Chase-Lev), owner works at bottom, thieves steal from top.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: allocator, atomic_compare_exchange, atomic_fence
+ *  Internal: wsdeque
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __WSDEQUE_HPP__
+#define __WSDEQUE_HPP__
+
+#include "tstl.hpp"
+
+namespace tstl {
+
+/// Work stealing deque
+/** Owner thread pushes and pops values at bottom by LIFO without atomic operations except one
+  * fence, other threads steal values from top by FIFO with one compare exchange. Owner and
+  * thieves race by compare exchange of top only for last value. Cyclo buffer has fixed size,
+  * push fails when it's full. Value is copied out before compare exchange and could be torn
+  * by push of owner, then exchange fails and copy isn't used, so Tvalue should be small
+  * plain data like pointer. */
+template <class Tvalue = void*, class Tallocator = allocator>
+
+class wsdeque
+{
+  Tvalue* storage;
+  const long size;    ///< power of 2
+  const long mask;
+
+  Tallocator allocator;
+
+  char top_pad [TS_CACHE_LINE_SIZE];
+  volatile long top;    ///< thieves take values here
+
+  char bottom_pad [TS_CACHE_LINE_SIZE];
+  volatile long bottom; ///< owner puts and takes values here
+
+  char end_pad [TS_CACHE_LINE_SIZE];
+
+  static long round_size (const long in_size)
+  {
+    long s = 2;
+    while (s < in_size) s <<= 1;
+    return s;
+  }
+
+public:
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  /** \param init_size - number of values, it's rounded up to power of 2 */
+  wsdeque (const long init_size = 0x400)
+         : storage (0), size (round_size (init_size) ), mask (round_size (init_size) - 1), top (0), bottom (0)
+  {
+    storage = (Tvalue*) allocator.allocate (sizeof (*storage) * size);
+    if (!storage) { brk (); }
+  }
+
+  ~wsdeque ()
+  { if (storage) { allocator.deallocate (storage), storage = 0; } }
+
+  /// Is not thread safe method
+  bool is_empty () const
+  { return 0 >= get_stat (); }
+
+  /// Get statistic about deque using
+  long get_stat () const
+  { return atomic_load_acquire (& bottom) - atomic_load_acquire (& top); }
+
+  /// Stores Tvalues at bottom, it's called by owner only.
+  /** \return true if Tvalues put into deque, false if it's full. */
+  bool push (const Tvalue* buffer)
+  {
+    if (!buffer || !storage) { brk (); return false; }
+
+    long b = atomic_load_relaxed (& bottom);
+    long t = atomic_load_acquire (& top);
+
+    if (b - t >= size)
+      return false;
+
+    storage [b & mask] = *buffer;
+
+    atomic_store_release (& bottom, b + 1); ///< value is visible before bottom
+    return true;
+  }
+
+  /// Retrives last pushed Tvalues, it's called by owner only.
+  /** \return true if Tvalues get from deque. */
+  bool pop (Tvalue* buffer);
+
+  /// Retrives first pushed Tvalues, it's called by any thread.
+  /** \return true if Tvalues get from deque, false if it's empty or other thread took value first. */
+  bool steal (Tvalue* buffer);
+};
+
+/// Retrives last pushed Tvalues, it's called by owner only.
+/** \return true if Tvalues get from deque. */
+template <class Tvalue, class Tallocator>
+bool wsdeque   <Tvalue,       Tallocator>
+
+:: pop (Tvalue* buffer)
+{
+  if (!buffer || !storage) { brk (); return false; }
+
+  long b = atomic_load_relaxed (& bottom) - 1;
+
+  atomic_store_relaxed (& bottom, b);
+
+  atomic_fence (); ///< thieves see decremented bottom before top is read
+
+  long t = atomic_load_relaxed (& top);
+
+  if (t > b) ///< deque is empty
+  { atomic_store_relaxed (& bottom, b + 1); return false; }
+
+  Tvalue value = storage [b & mask];
+
+  if (t == b) ///< last value, thieves race for it
+  {
+    bool won = t == atomic_compare_exchange ( (long*) & top, t + 1, t);
+
+    atomic_store_relaxed (& bottom, b + 1);
+
+    if (!won)
+      return false;
+  }
+
+  *buffer = value;
+  return true;
+}
+
+/// Retrives first pushed Tvalues, it's called by any thread.
+/** \return true if Tvalues get from deque, false if it's empty or other thread took value first. */
+template <class Tvalue, class Tallocator>
+bool wsdeque   <Tvalue,       Tallocator>
+
+:: steal (Tvalue* buffer)
+{
+  if (!buffer || !storage) { brk (); return false; }
+
+  long t = atomic_load_acquire (& top);
+
+  atomic_fence (); ///< top is read before bottom, pairs with fence of pop
+
+  long b = atomic_load_acquire (& bottom);
+
+  if (t >= b)
+    return false;
+
+  Tvalue value = storage [t & mask];
+
+  if (t != atomic_compare_exchange ( (long*) & top, t + 1, t) )
+    return false; ///< owner or other thief took it
+
+  *buffer = value;
+  return true;
+}
+
+}; /* end of tstl namespace */
+
+#endif /* __WSDEQUE_HPP__ */
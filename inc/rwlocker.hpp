@@ -12,8 +12,8 @@
  *
  *  Classes, methods and structures: \details
  *
- *  External: melocker (relocker), ts_sleep
- *  Internal: rwlocker, emptylock :: rwlocker
+ *  External: melocker (relocker), ts_sleep, futex_wait, futex_wake, thread_slot, ts_current_thread
+ *  Internal: rwlocker, srwlocker, emptylock :: rwlocker
  *
  *  TODO:		\todo
  *
@@ -23,6 +23,9 @@
 #define __RWLOCKER_HPP__
 
 #include "impl/relocker.hpp"
+#include "impl/tsthread.h"
+
+#define TS_RWLOCKER_STRIPES 16
 
 namespace tstl {
 
@@ -80,6 +83,121 @@ public:
   }
 };
 
+/// Scalable writer multiply reader guard
+/** Readers touch only own stripe of readers counters (stripe is chosen by thread slot),
+  * so readers of different threads don't share cache lines. Writer raises writer flag,
+  * drains all stripes and parks till last reader leaves. Incoming readers park while
+  * writer flag is raised, so writers don't starve. Interface is same as rwlocker has:
+  * read_unlock finds stripe of reader again, it's thread slot in user mode and hash of
+  * current thread object in kernel mode (processor number is changed by migration). */
+template <class Tlocker = melocker<>, long Tstripes = TS_RWLOCKER_STRIPES> ///< 'relocker' is posible locking policy
+
+class srwlocker
+{
+  typedef struct TS_CACHE_LINE_ALIGNED readers_stripe
+  {
+    volatile long readers;
+    char pad [TS_CACHE_LINE_SIZE - sizeof (long)];
+  } rs, *prs;
+
+  rs stripes [Tstripes];
+
+  volatile long writer;  ///< writer owns resource or drains readers
+  volatile long drained; ///< readers leave sequence, writer parks on it
+  char pad [TS_CACHE_LINE_SIZE - 2 * sizeof (long)];
+
+  Tlocker writers_locker;
+
+  /// Stripe of calling thread, it's same for read_lock and read_unlock of thread
+  static long reader_stripe ()
+  {
+#if defined (TS_HAS_THREAD_LOCAL)
+    return thread_slot () % Tstripes;
+#else
+    size_t key = (size_t) ts_current_thread ();
+
+    key ^= key >> 7, key ^= key >> 13;
+    return (long) (key % Tstripes);
+#endif
+  }
+
+  /// Leave stripe and wake writer if it drains readers
+  void leave (prs ps)
+  {
+    if (!atomic_dec_return ( (long*) & ps->readers) && writer)
+    {
+      atomic_inc ( (long*) & drained);
+      futex_wake (& drained, 1);
+    }
+  }
+
+public:
+  srwlocker () : writer (0), drained (0)
+  { memset (stripes, 0, sizeof (stripes) ); }
+
+  ~srwlocker ()
+  {
+    for (long i = 0; i < Tstripes; i++)
+      if (stripes [i].readers) brk ();
+  }
+
+  /// Call this to gain shared read access
+  void read_lock ()
+  {
+    prs ps = & stripes [reader_stripe ()];
+
+    for (;;)
+    {
+      while (writer)
+        futex_wait (& writer, 1); ///< Park any readers if write operation detected
+
+      atomic_inc ( (long*) & ps->readers);
+
+      if (!writer)
+        return;
+
+      leave (ps); ///< writer came, give way to it
+    }
+  }
+
+  /// Call this when done accessing the resource
+  void read_unlock ()
+  { leave (& stripes [reader_stripe ()]); }
+
+  /// Call this to gain exclusive write access
+  void write_lock ()
+  {
+    writers_locker.lock ();
+
+    atomic_exchange ( (long*) & writer, 1);
+
+    for (long i = 0; i < Tstripes; i++)
+    {
+      long counter = TS_SPINLOCK_COUNTER;
+
+      while (stripes [i].readers && --counter > 0)
+        ts_yield_processor ();
+
+      while (stripes [i].readers)
+      {
+        long sequence = drained;
+
+        if (stripes [i].readers)
+          futex_wait (& drained, sequence);
+      }
+    }
+  }
+
+  /// Call this when done accessing the resource
+  void write_unlock ()
+  {
+    atomic_exchange ( (long*) & writer, 0);
+    futex_wake (& writer, TS_FUTEX_WAKE_ALL);
+
+    writers_locker.unlock ();
+  }
+};
+
 /// Needs for turn off synchronization where used rwlocker
 namespace emptylock {
 
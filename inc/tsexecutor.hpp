@@ -0,0 +1,387 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file tsexecutor.hpp
+ *
+ *  Abstract:		\brief Thread pool executor with work stealing deques per worker.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: wsdeque, iqueue, iqalloc_cache, eventcount, thread_create
+ *  Internal: executor, executor_task, task_routine
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __TSEXECUTOR_HPP__
+#define __TSEXECUTOR_HPP__
+
+#include "tsqueue.hpp"
+#include "impl/wsdeque.hpp"
+#include "impl/tsevent.hpp"
+#include "impl/tsthread.h"
+
+#if defined (TS_HAS_THREADS)
+
+#define TS_EXECUTOR_DEQUE_SIZE 0x400 ///< default size of worker deque
+#define TS_EXECUTOR_TASKS      0x1000 ///< default number of cached task nodes
+#define TS_EXECUTOR_CHAIN      64     ///< tasks put into injection queue by one exchange
+
+namespace tstl {
+
+typedef void (*task_routine) (void* context);
+
+/// Task given to submit_bulk
+typedef struct executor_task
+{
+  task_routine routine;
+  void* context;
+} et, *pet;
+
+/// Thread pool executor
+/** Every worker has own work stealing deque, tasks submitted by worker go to its deque and
+  * they are run by LIFO, tasks submitted from other threads go to shared injection queue.
+  * Worker without tasks takes them from injection queue and steals from deques of other
+  * workers, idle worker parks on eventcount futex and submit wakes one of them. Task nodes
+  * are taken from allocating cache, so steady state execution doesn't call malloc. Destructor
+  * runs all submitted tasks before workers are stopped. */
+template <class Tallocator = allocator, class Tlocker = melocker<>,
+          class Talloc_cache = iqalloc_cache <char, Tallocator, Tallocator> >
+
+class executor
+{
+  typedef executor_task* ptask;
+
+  typedef struct worker
+  {
+    executor* owner;
+    long index;
+    wsdeque <ptask, Tallocator> deque;
+    ts_thread_handle thread;
+    bool started;
+
+    worker (executor* in_owner, const long in_index, const long deque_size)
+          : owner (in_owner), index (in_index), deque (deque_size), started (false) {}
+  } wk, *pwk;
+
+  pwk* workers;
+  long workers_number;
+
+  iqueue <ptask, Tlocker, Tallocator, Talloc_cache>* injection; ///< tasks submitted out of workers
+
+  Talloc_cache* ptask_cache;
+
+  Tallocator allocator;
+
+  volatile long stopping;
+
+  eventcount idle; ///< workers without tasks wait on it
+
+  /// Worker of this executor which runs calling thread, 0 for other threads
+  pwk current_worker () const
+  {
+    pwk pw = this_worker ();
+    return pw && this == pw->owner ? pw : 0;
+  }
+
+  static pwk& this_worker ()
+  {
+    static ts_thread_local pwk pw = 0;
+    return pw;
+  }
+
+  ptask make_task (const task_routine routine, void* context)
+  {
+    ptask pt = (ptask) ptask_cache->get (sizeof (*pt) ); ///< cache goes to global mempool if it's over
+
+    if (!pt)
+      return 0;
+
+    pt->routine = routine;
+    pt->context = context;
+    return pt;
+  }
+
+  /// Take task from own deque, injection queue or deques of other workers
+  bool find_task (pwk pw, ptask& pt);
+
+  /// Free task node and run routine
+  void run_task (ptask pt)
+  {
+    task_routine routine = pt->routine;
+    void* context = pt->context;
+
+    ptask_cache->revert ( (char*) pt), pt = 0;
+
+    routine (context);
+  }
+
+  /// Put tasks into injection queue, tasks which aren't put are freed
+  long put_chain (ptask* chain, const long number)
+  {
+    long put = injection->put_bulk (chain, number);
+
+    for (long i = put; i < number; i++) ///< memory of queue is over
+      ptask_cache->revert ( (char*) chain [i]), chain [i] = 0;
+
+    return put;
+  }
+
+  static ts_thread_return TS_THREAD_CALL worker_routine (void* context);
+
+public:
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  /** \param in_workers_number - number of worker threads, 0 means number of processors
+    * \param tasks_number      - number of cached task nodes
+    * \param deque_size        - size of worker deque, submit goes to injection queue if it's full */
+  executor (const long in_workers_number = 0,
+            const long tasks_number = TS_EXECUTOR_TASKS,
+            const long deque_size = TS_EXECUTOR_DEQUE_SIZE);
+
+  ~executor ();
+
+  /// Number of started workers
+  long get_workers_number () const
+  { return workers_number; }
+
+  /// Get statistic about tasks which aren't taken by workers yet
+  long get_stat () const
+  {
+    long used = injection ? injection->get_stat () : 0;
+
+    for (long i = 0; i < workers_number; i++)
+      used += workers [i]->deque.get_stat ();
+
+    return used;
+  }
+
+  /// Runs routine (context) by one of workers.
+  /** \return true if task is submitted, false if there isn't memory or executor is stopping. */
+  bool submit (const task_routine routine, void* context = 0);
+
+  /// Runs batch of tasks, workers are waked once.
+  /** \return number of submitted tasks. */
+  long submit_bulk (const executor_task* tasks, const long counter);
+};
+
+template <class Tallocator, class Tlocker, class Talloc_cache>
+executor       <Tallocator,       Tlocker,       Talloc_cache>
+
+:: executor (const long in_workers_number, const long tasks_number, const long deque_size)
+           : workers (0), workers_number (0), injection (0), ptask_cache (0), stopping (0)
+{
+  long number = in_workers_number > 0 ? in_workers_number : (long) ts_processors_number;
+
+  if (number <= 0)
+    number = 1;
+
+  ptask_cache = new Talloc_cache (sizeof (et), tasks_number);
+  if (!ptask_cache) { brk (); return; }
+
+  injection = new iqueue <ptask, Tlocker, Tallocator, Talloc_cache> (tasks_number, true);
+  if (!injection) { brk (); return; }
+
+  workers = (pwk*) allocator.allocate (sizeof (*workers) * number);
+  if (!workers) { brk (); return; }
+
+  for (long i = 0; i < number; i++)
+  {
+    workers [i] = new worker (this, i, deque_size);
+    if (!workers [i]) { brk (); return; }
+
+    workers_number++;
+  }
+
+  /// workers are started after all deques are made, they steal from each other
+  for (long i = 0; i < workers_number; i++)
+    if (!(workers [i]->started = thread_create (workers [i]->thread, worker_routine, workers [i]) ) )
+    { brk (); }
+}
+
+template <class Tallocator, class Tlocker, class Talloc_cache>
+executor       <Tallocator,       Tlocker,       Talloc_cache>
+
+:: ~executor ()
+{
+  atomic_exchange ( (long*) & stopping, 1);
+
+  idle.close ();
+
+  for (long i = 0; i < workers_number; i++)
+    if (workers [i]->started)
+      thread_join (workers [i]->thread);
+
+  /// tasks left if there wasn't any started worker
+  ptask pt = 0;
+
+  for (long i = 0; i < workers_number; i++)
+    while (workers [i]->deque.steal (& pt) )
+      ptask_cache->revert ( (char*) pt), pt = 0;
+
+  if (injection)
+  {
+    while (injection->get (& pt) )
+      ptask_cache->revert ( (char*) pt), pt = 0;
+
+    delete injection, injection = 0;
+  }
+
+  for (long i = 0; i < workers_number; i++)
+    delete workers [i], workers [i] = 0;
+
+  if (workers) { allocator.deallocate (workers), workers = 0; }
+
+  if (ptask_cache) { delete ptask_cache, ptask_cache = 0; }
+}
+
+/// Take task from own deque, injection queue or deques of other workers
+template <class Tallocator, class Tlocker, class Talloc_cache>
+bool executor  <Tallocator,       Tlocker,       Talloc_cache>
+
+:: find_task (pwk pw, ptask& pt)
+{
+  if (pw->deque.pop (& pt) )
+    return true;
+
+  if (injection->get (& pt) )
+    return true;
+
+  for (long i = 1; i < workers_number; i++)
+  {
+    pwk victim = workers [(pw->index + i) % workers_number];
+
+    /// steal fails on race too, so it's tried again while victim has tasks
+    while (!victim->deque.is_empty () )
+      if (victim->deque.steal (& pt) )
+        return true;
+  }
+
+  return false;
+}
+
+template <class Tallocator, class Tlocker, class Talloc_cache>
+ts_thread_return TS_THREAD_CALL executor <Tallocator, Tlocker, Talloc_cache>
+
+:: worker_routine (void* context)
+{
+  pwk pw = (pwk) context;
+  executor* pe = pw->owner;
+
+  this_worker () = pw;
+
+  for (;;)
+  {
+    ptask pt = 0;
+
+    if (pe->find_task (pw, pt) )
+    { pe->run_task (pt); continue; }
+
+    long key = pe->idle.prepare_wait ();
+
+    if (pe->find_task (pw, pt) )
+    { pe->idle.cancel_wait (); pe->run_task (pt); continue; }
+
+    if (atomic_load_acquire (& pe->stopping) ) ///< all tasks are run
+    { pe->idle.cancel_wait (); break; }
+
+    pe->idle.wait (key);
+  }
+
+  this_worker () = 0;
+  return 0;
+}
+
+/// Runs routine (context) by one of workers.
+/** \return true if task is submitted, false if there isn't memory or executor is stopping. */
+template <class Tallocator, class Tlocker, class Talloc_cache>
+bool executor  <Tallocator,       Tlocker,       Talloc_cache>
+
+:: submit (const task_routine routine, void* context)
+{
+  if (!routine || !ptask_cache || !injection) { brk (); return false; }
+
+  pwk pw = current_worker ();
+
+  if (!pw && atomic_load_acquire (& stopping) )
+    return false;
+
+  ptask pt = make_task (routine, context);
+
+  if (!pt)
+  { brk (); return false; }
+
+  if (!(pw && pw->deque.push (& pt) )
+   && !injection->put (& pt) )
+  {
+    ptask_cache->revert ( (char*) pt), pt = 0;
+    return false;
+  }
+
+  idle.notify_one ();
+  return true;
+}
+
+/// Runs batch of tasks, workers are waked once.
+/** \return number of submitted tasks. */
+template <class Tallocator, class Tlocker, class Talloc_cache>
+long executor  <Tallocator,       Tlocker,       Talloc_cache>
+
+:: submit_bulk (const executor_task* tasks, const long counter)
+{
+  if (!tasks || counter <= 0 || !ptask_cache || !injection) { brk (); return 0; }
+
+  pwk pw = current_worker ();
+
+  if (!pw && atomic_load_acquire (& stopping) )
+    return 0;
+
+  ptask chain [TS_EXECUTOR_CHAIN]; ///< tasks for injection queue are put by one head exchange
+  long number = 0, submitted = 0;
+
+  for (long i = 0; i < counter; i++)
+  {
+    ptask pt = tasks [i].routine ? make_task (tasks [i].routine, tasks [i].context) : 0;
+
+    if (!pt)
+    { brk (); break; }
+
+    if (pw && pw->deque.push (& pt) )
+    { submitted++; continue; }
+
+    chain [number++] = pt;
+
+    if (TS_EXECUTOR_CHAIN == number)
+    {
+      long put = put_chain (chain, number);
+      bool over = put < number;
+
+      submitted += put, number = 0;
+
+      if (over)
+        break;
+    }
+  }
+
+  if (number)
+    submitted += put_chain (chain, number);
+
+  if (submitted)
+    idle.notify_all ();
+
+  return submitted;
+}
+
+}; /* end of tstl namespace */
+
+#endif ///< TS_HAS_THREADS
+
+#endif /* __TSEXECUTOR_HPP__ */
@@ -0,0 +1,270 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file tsmsgpipe.hpp
+ *
+ *  Abstract:		\brief Message pipe, transports different length messages with headers over pipe.
+ *
+ *  Author:		\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  External: pipe
+ *  Internal: msg_pipe
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __TSMSGPIPE_HPP__
+#define __TSMSGPIPE_HPP__
+
+#include "tspipe.hpp"
+
+#define TS_MSG_SKIP  0xFFFFFFFF ///< type of record which skips rest of cyclo buffer
+
+namespace tstl {
+
+/// Message pipe class template
+/** put_msg	- stores   message (thread safe).
+  * get_msg	- retrives message.
+  * peek_msg	- gives message in place.
+  * peek_msgs	- gives batch of messages in place.
+  * consume_msgs	- frees messages given by peek_msg or peek_msgs.
+  *
+  * Every message is stored as header (length and type) and payload, frames are aligned by
+  * header size. Frame is contiguous always: mirrored storage is used if it's supported,
+  * otherwise writer puts skip record before frame which would be cut by end of cyclo buffer. */
+template <class Tsize = unsigned long, class Tlocker = melocker<>, class Tallocator = allocator>
+
+class msg_pipe : pipe <char, Tsize, Tlocker, Tallocator>
+{
+  typedef pipe <char, Tsize, Tlocker, Tallocator> base;
+
+  typedef struct msg_header
+  {
+    unsigned int length; ///< payload length, it's frame length for skip record
+    unsigned int type;
+  } mh, *pmh;
+
+  Tsize peeked_size;   ///< frames given by peek_msgs
+
+  static Tsize frame_size (const unsigned long length)
+  { return (Tsize) ( (sizeof (mh) + length + sizeof (mh) - 1) & ~(sizeof (mh) - 1) ); }
+
+public:
+  /// Message given in place
+  typedef struct msg_view
+  {
+    const char*   data;
+    unsigned long length;
+    unsigned long type;
+  } mv, *pmv;
+
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  /** \param init_size        - storage size in bytes, it's rounded up to header size
+    * \param in_single_writer - there is one writer thread, put_msg doesn't lock
+    * \param in_mirrored      - map storage twice, so skip records aren't needed */
+  msg_pipe (const Tsize init_size = 0x10000, const bool in_single_writer = false, const bool in_mirrored = true)
+          : base ( (Tsize) ( (init_size + sizeof (mh) - 1) & ~(sizeof (mh) - 1) ), in_single_writer, in_mirrored),
+            peeked_size (0) {}
+
+  /// Check pipe usage
+  bool is_empty () const
+  { return base :: is_empty (); }
+
+  /// Get statistic about pipe using, it's bytes of frames
+  long get_stat () const
+  { return base :: get_stat (); }
+
+  /// Wake all waiters for shutdown
+  void close ()
+  { base :: close (); }
+
+  /// Stores message.
+  /** \param buffer - payload
+    * \param length - payload length
+    * \param type   - message type below TS_MSG_SKIP, it's stored by 32 bits
+    * \return true if message is put into pipe, false if there isn't free space. */
+  bool put_msg (const void* buffer, const unsigned long length, const unsigned long type = 0);
+
+  /// Retrives message.
+  /** \param buffer - payload
+    * \param length - in buffer size, out message length
+    * \param type   - out message type if it isn't 0
+    * \return true if message is got, false if pipe is empty or buffer is smaller than length. */
+  bool get_msg (void* buffer, unsigned long& length, unsigned long* type = 0);
+
+  /// Gives message in place, consume_msgs frees it.
+  /** \return true if message is given. */
+  bool peek_msg (mv& view)
+  { return 1 == peek_msgs (& view, 1); }
+
+  /// Gives up to counter messages in place, consume_msgs frees all of them.
+  /** \return number of given messages. */
+  Tsize peek_msgs (pmv views, const Tsize counter);
+
+  /// Frees messages given by peek_msg or peek_msgs.
+  bool consume_msgs ()
+  {
+    Tsize size = peeked_size;
+
+    peeked_size = 0;
+    return base :: consume (size);
+  }
+};
+
+/// Stores message.
+/** \param buffer - payload
+  * \param length - payload length
+  * \param type   - message type below TS_MSG_SKIP, it's stored by 32 bits
+  * \return true if message is put into pipe, false if there isn't free space. */
+template <class Tsize, class Tlocker, class Tallocator>
+bool msg_pipe  <Tsize,       Tlocker,       Tallocator>
+
+:: put_msg (const void* buffer, const unsigned long length, const unsigned long type)
+{
+  if ( (!buffer && length) || type >= TS_MSG_SKIP || length > TS_MSG_SKIP) ///< wider type could be truncated to TS_MSG_SKIP
+  { brk (); return false; }
+
+  typename base :: span sp;
+
+  Tsize frame = frame_size (length);
+  Tsize got   = base :: reserve_write (sp, frame);
+
+  if (got < frame) ///< there isn't free space
+  { if (got) base :: commit_write (0); return false; }
+
+  if (sp.size [0] < frame) ///< frame is cut by end of cyclo buffer, reserve rest of buffer too
+  {
+    Tsize rest = sp.size [0];
+
+    base :: commit_write (0);
+
+    got = base :: reserve_write (sp, rest + frame);
+
+    if (got < rest + frame)
+    { if (got) base :: commit_write (0); return false; }
+  }
+
+  Tsize skip = 0;
+
+  if (sp.size [0] < frame) ///< rest of buffer is skipped by record
+  {
+    if (sp.size [0] < sizeof (mh)
+     || sp.size [1] < frame)
+    { brk (); base :: commit_write (0); return false; }
+
+    pmh ps = (pmh) sp.part [0];
+    ps->length = (unsigned int) sp.size [0];
+    ps->type   = TS_MSG_SKIP;
+
+    skip = sp.size [0];
+    sp.part [0] = sp.part [1];
+  }
+
+  pmh ph = (pmh) sp.part [0];
+  ph->length = (unsigned int) length;
+  ph->type   = (unsigned int) type;
+
+  if (length)
+    memcpy (ph + 1, buffer, length);
+
+  return base :: commit_write (skip + frame);
+}
+
+/// Retrives message.
+/** \param buffer - payload
+  * \param length - in buffer size, out message length
+  * \param type   - out message type if it isn't 0
+  * \return true if message is got, false if pipe is empty or buffer is smaller than length. */
+template <class Tsize, class Tlocker, class Tallocator>
+bool msg_pipe  <Tsize,       Tlocker,       Tallocator>
+
+:: get_msg (void* buffer, unsigned long& length, unsigned long* type)
+{
+  if (!buffer && length) { brk (); return false; }
+
+  mv view;
+
+  if (!peek_msg (view) )
+    return false;
+
+  if (view.length > length) ///< message stays in pipe
+  { length = view.length, peeked_size = 0; return false; }
+
+  if (view.length)
+    memcpy (buffer, view.data, view.length);
+
+  length = view.length;
+
+  if (type)
+    *type = view.type;
+
+  return consume_msgs ();
+}
+
+/// Gives up to counter messages in place, consume_msgs frees all of them.
+/** \return number of given messages. */
+template <class Tsize, class Tlocker, class Tallocator>
+Tsize msg_pipe <Tsize,       Tlocker,       Tallocator>
+
+:: peek_msgs (pmv views, const Tsize counter)
+{
+  if (!views || !counter) { brk (); return 0; }
+
+  for (;;)
+  {
+    typename base :: span sp;
+
+    Tsize number = 0;
+
+    peeked_size = 0;
+
+    if (!base :: peek_read (sp, ~ (Tsize) 0) )
+      return 0;
+
+    for (long i = 0; i < 2 && number < counter; i++)
+    {
+      char* p    = sp.part [i];
+      Tsize rest = sp.size [i];
+
+      while (number < counter && rest >= sizeof (mh) )
+      {
+        pmh ph = (pmh) p;
+
+        Tsize frame = TS_MSG_SKIP == ph->type ? (Tsize) ph->length : frame_size (ph->length);
+
+        if (!frame || frame > rest) ///< frame is committed whole always
+        { brk (); return number; }
+
+        if (TS_MSG_SKIP != ph->type)
+        {
+          views [number].data   = (const char*) (ph + 1);
+          views [number].length = ph->length;
+          views [number].type   = ph->type;
+          number++;
+        }
+
+        p    += frame;
+        rest -= frame;
+        peeked_size += frame;
+      }
+    }
+
+    if (number || !peeked_size)
+      return number;
+
+    consume_msgs (); ///< there were skip records only
+  }
+}
+
+}; /* end of tstl namespace */
+
+#endif /* __TSMSGPIPE_HPP__ */
@@ -11,7 +11,7 @@
  *
  *  Classes, methods and structures: \details
  *
- *  External: allocator, melocker (relocker)
+ *  External: allocator, melocker (relocker), eventcount, mirror_allocate
  *  Internal: pipe
  *
  *  TODO:		\todo
@@ -22,29 +22,69 @@
 #define __TSPIPE_HPP__
 
 #include "impl/relocker.hpp"
+#include "impl/tsevent.hpp"
+#include "impl/tsmirror.h"
 
 namespace tstl {
 
 /// Pipe class template
 /** put		- stores   data (thread safe).
   * get		- retrives data (thread safe).
+  * put_wait	- stores   data, waits for free space.
+  * get_wait	- retrives data, waits for data.
+  * close	- wakes all waiters for shutdown.
+  * reserve_write	- gives free space of storage for writing in place.
+  * commit_write	- publishes values written in reserved space.
+  * peek_read	- gives stored values for reading in place.
+  * consume	- frees values read in place.
   * free_size	- returns the size of the free space.
-  * used_size	- returns the size of the used space. */
+  * used_size	- returns the size of the used space.
+  *
+  * Pipe has one reader always. Writers take head_locker, one writer (single_writer) doesn't
+  * take any locker. Head and tail live on own cache lines, they are published by release and
+  * read by acquire, every side keeps last seen offset of other side and rereads it only when
+  * cached one shows not enough space or data.
+  *
+  * Mirrored pipe maps storage twice back to back, so any free space and any stored values
+  * are contiguous and copies aren't cut by end of cyclo buffer. Ordinary storage is used
+  * if mirrored one isn't supported. */
 template <class Tvalue, class Tsize = unsigned long, class Tlocker = melocker<>, class Tallocator = allocator>
 
 class pipe
 {
   Tvalue*  storage;    ///< cyclo buffer
-  volatile Tsize buffer_size; ///< cyclo buffer size
-  volatile Tsize head; ///< head offset
-  volatile Tsize tail; ///< tail offset
+  Tsize    buffer_size; ///< cyclo buffer size
+  const bool single_writer; ///< there is one writer, head_locker isn't used
+  bool     mirrored;   ///< storage is mapped twice back to back
+
+  char head_pad [TS_CACHE_LINE_SIZE];
+  volatile Tsize head; ///< head offset, it's changed by writers
+  Tsize cached_tail;   ///< tail seen by writers last time
+  Tsize reserved;      ///< space given by reserve_write
   Tlocker head_locker; ///< Head protection on multi writers
+
+  char tail_pad [TS_CACHE_LINE_SIZE];
+  volatile Tsize tail; ///< tail offset, it's changed by reader
+  Tsize cached_head;   ///< head seen by reader last time
+  Tsize peeked;        ///< values given by peek_read
+
+  char end_pad [TS_CACHE_LINE_SIZE];
+
   Tallocator allocator;
 
+  eventcount readable; ///< reader waits on it
+  eventcount writable; ///< writers wait on it
+
   bool copy (Tvalue* destination, const Tvalue* source, const Tsize values_number)
   {
     if (!destination || !source || !values_number) { brk (); return false; }
 
+    if (value_traits <Tvalue> :: is_pod)
+    {
+      memcpy (destination, source, values_number * sizeof (Tvalue) );
+      return true;
+    }
+
     tstl :: allocator a;
 
     for (Tsize counter = 0;
@@ -55,17 +95,80 @@ class pipe
     return true;
   }
 
+  /// Free space between lhead and ltail, one value is reserved to distinguish full pipe
+  /** \param[out] part_size is free space up to end of cyclo buffer */
+  Tsize get_free_size (const Tsize lhead, const Tsize ltail, Tsize& part_size) const
+  {
+    if (lhead < ltail) ///< :DDDD_H........T_DDDD:
+    {
+      part_size = ltail - 1 - lhead;
+      return part_size;
+    }
+    else /// (lTail <= Head) :......T_DDDDD_H......:
+    {
+      part_size = buffer_size - lhead;
+
+      if (mirrored) ///< space goes on in second view
+        part_size += ltail - 1;
+
+      return buffer_size - lhead + ltail - 1;
+    }
+  }
+
+  /// Used space between ltail and lhead
+  /** \param[out] part_size is used space up to end of cyclo buffer */
+  Tsize get_used_size (const Tsize lhead, const Tsize ltail, Tsize& part_size) const
+  {
+    if (lhead < ltail) ///< :DDDD_H........T_DDDD:
+    {
+      part_size = buffer_size - ltail;
+
+      if (mirrored) ///< values go on in second view
+        part_size += lhead;
+
+      return buffer_size - ltail + lhead;
+    }
+    else /// (Tail <= lHead) :......T_DDDDD_H......:
+    {
+      part_size = lhead - ltail;
+      return part_size;
+    }
+  }
+
 public:
+  /// Space of storage, second part is used when space crosses end of cyclo buffer
+  typedef struct pipe_span
+  {
+    Tvalue* part [2];
+    Tsize   size [2];
+  } span, *pspan;
+
   void* operator new (size_t size)
   { Tallocator allocator; return allocator.allocate (size); }
 
   void operator delete (void* p)
   { Tallocator allocator; allocator.deallocate (p); }
 
-  pipe (const Tsize init_size = 0x1000) : storage (0), tail (0), head (0), buffer_size (0)
+  /** \param in_single_writer - there is one writer thread, put doesn't lock
+    * \param in_mirrored      - map storage twice, init_size is rounded up to pages */
+  pipe (const Tsize init_size = 0x1000, const bool in_single_writer = false, const bool in_mirrored = false)
+      : storage (0), buffer_size (0), single_writer (in_single_writer), mirrored (false),
+        head (0), cached_tail (0), reserved (0), tail (0), cached_head (0), peeked (0)
   {
     buffer_size = init_size;
-    storage = (Tvalue*) allocator.allocate (buffer_size * sizeof (Tvalue) );
+
+    if (in_mirrored && mirror_page_size () )
+    { /// size is rounded up to pages, it must keep whole values
+      size_t page = mirror_page_size ();
+      size_t size = (buffer_size * sizeof (Tvalue) + page - 1) / page * page;
+
+      if (!(size % sizeof (Tvalue) )
+       && (storage = (Tvalue*) mirror_allocate (size) ) )
+        mirrored = true, buffer_size = (Tsize) (size / sizeof (Tvalue) );
+    }
+
+    if (!storage) ///< ordinary storage is fallback
+      storage = (Tvalue*) allocator.allocate (buffer_size * sizeof (Tvalue) );
 
     if (!storage) { brk (); return; }
 
@@ -73,13 +176,24 @@ public:
   }
 
   ~pipe ()
-  { if (storage) { allocator.deallocate (storage), storage = 0; } else { brk (); } }
+  {
+    if (!storage) { brk (); return; }
+
+    if (mirrored)
+      mirror_deallocate (storage, buffer_size * sizeof (Tvalue) ), storage = 0;
+    else
+      allocator.deallocate (storage), storage = 0;
+  }
+
+  /// Storage is mapped twice, free space and stored values are contiguous always
+  bool is_mirrored () const
+  { return mirrored; }
 
   /// Returns the size of the free space.
-  Tsize free_size ();
+  Tsize free_size () const;
 
   /// Returns the size of the used space.
-  Tsize used_size ();
+  Tsize used_size () const;
 
   /// Check pipe usage
   bool is_empty () const
@@ -100,42 +214,88 @@ public:
     * \param counter - Tvalues counter
     * \return true if Tvalues get from pipe. */
   bool get (Tvalue* buffer, Tsize counter = 1);
+
+  /// Gives up to counter free values of storage for writing in place.
+  /** Writer keeps head_locker till commit_write if it isn't single_writer pipe.
+    * \param sp      - free space, it's one or two parts of storage
+    * \param counter - wanted Tvalues counter
+    * \return reserved Tvalues counter, commit_write must be called if it isn't 0. */
+  Tsize reserve_write (span& sp, Tsize counter);
+
+  /// Publishes counter values written in reserved space.
+  /** \param counter - written Tvalues counter, 0 cancels reserve
+    * \return false if counter is more than reserved space. */
+  bool commit_write (Tsize counter);
+
+  /// Gives up to counter stored values for reading in place.
+  /** \param sp      - stored values, it's one or two parts of storage
+    * \param counter - wanted Tvalues counter
+    * \return stored Tvalues counter given by sp. */
+  Tsize peek_read (span& sp, Tsize counter);
+
+  /// Frees counter values read in place.
+  /** \param counter - read Tvalues counter
+    * \return false if counter is more than given by peek_read. */
+  bool consume (Tsize counter);
+
+  /// Stores Tvalues, waits while there isn't free space for them.
+  /** \param timeout - milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if pipe is closed. */
+  bool put_wait (Tvalue* buffer, Tsize counter = 1, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    bool rc = false;
+
+    if (writable.is_closed () || counter >= buffer_size)
+      return false;
+
+    ts_event_wait (writable, put (buffer, counter), timeout, rc);
+    return rc;
+  }
+
+  /// Retrives Tvalues, waits till they come.
+  /** \param timeout - milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if pipe is closed and hasn't enough data. */
+  bool get_wait (Tvalue* buffer, Tsize counter = 1, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    bool rc = false;
+    ts_event_wait (readable, get (buffer, counter), timeout, rc);
+    return rc;
+  }
+
+  /// Wake all waiters for shutdown, next put_wait fails at once
+  void close ()
+  {
+    writable.close ();
+    readable.close ();
+  }
 };
 
 /// Returns the size of the free space.
 template <class Tvalue, class Tsize, class Tlocker, class Tallocator>
 Tsize pipe     <Tvalue,       Tsize,       Tlocker,       Tallocator>
 
-:: free_size ()
+:: free_size () const
 {
   if (!storage)
     return 0;
 
-  Tsize ltail = tail, lhead = head; ///< Tail and Head may be changed
+  Tsize part_size = 0;
 
-  /// check empty space
-  if (ltail > lhead)
-    return ltail - lhead;
-  else
-    return buffer_size - lhead + ltail;
+  return get_free_size (atomic_load_acquire (& head), atomic_load_acquire (& tail), part_size);
 }
 
 /// Returns the size of the used space.
 template <class Tvalue, class Tsize, class Tlocker, class Tallocator>
 Tsize pipe     <Tvalue,       Tsize,       Tlocker,       Tallocator>
 
-:: used_size ()
+:: used_size () const
 {
   if (!storage)
     return buffer_size;
 
-  Tsize ltail = tail, lhead = head; ///< Tail and Head may be changed
+  Tsize part_size = 0;
 
-  /// get the size of the used space
-  if (lhead >= ltail)
-    return lhead - ltail;
-  else
-    return buffer_size - ltail + lhead;
+  return get_used_size (atomic_load_acquire (& head), atomic_load_acquire (& tail), part_size);
 }
 
 /// Stores Tvalues.
@@ -153,44 +313,37 @@ bool pipe      <Tvalue,       Tsize,       Tlocker,       Tallocator>
   if (!counter)
     return true;
 
-  head_locker.lock ();
+  if (!single_writer) head_locker.lock ();
 
-  Tsize free_size, part_size, ltail = tail; ///< Tail may be changed
+  Tsize part_size, lhead = atomic_load_relaxed (& head); ///< Head is changed by this writer only
 
-  /// check if the free space is available
-  if (head < ltail) ///< :DDDD_H........T_DDDD:
-  {
-    free_size = ltail - 1 - head;
-    part_size = free_size;
-  }
-  else /// (lTail <= Head) :......T_DDDDD_H......:
+  /// check if the free space is available by cached tail, reread tail if it isn't
+  Tsize free_size = get_free_size (lhead, cached_tail, part_size);
+
+  if (free_size < counter)
   {
-    part_size = buffer_size - head;
-    free_size = part_size + ltail - 1;
+    cached_tail = atomic_load_acquire (& tail); ///< reader released values before tail
+    free_size = get_free_size (lhead, cached_tail, part_size);
   }
 
   if (free_size > buffer_size
    || part_size > buffer_size)
-  { brk (); head_locker.unlock (); return false; }
+  { brk (); if (!single_writer) head_locker.unlock (); return false; }
 
-  if (free_size < counter)
-  {
-    brk (); ///< pipe buffer is fully used, increase buffer or wait
-    head_locker.unlock ();
-    return false;
-  }
+  if (free_size < counter) ///< pipe buffer is fully used, increase buffer or use put_wait
+  { if (!single_writer) head_locker.unlock (); return false; }
 
   Tsize pos = 0;
 
   if (counter > part_size) ///< do cust
   {
-    if (head + part_size > buffer_size
-    || !copy (& storage [head], & buffer [pos], part_size) )
-    { brk (); head_locker.unlock (); return false; }
+    if (lhead + part_size > buffer_size
+    || !copy (& storage [lhead], & buffer [pos], part_size) )
+    { brk (); if (!single_writer) head_locker.unlock (); return false; }
 
-    head += part_size;
+    lhead += part_size;
 
-    if (head == buffer_size) head = 0;
+    if (lhead == buffer_size) lhead = 0;
 
     counter -= part_size;
     pos     += part_size;
@@ -198,16 +351,20 @@ bool pipe      <Tvalue,       Tsize,       Tlocker,       Tallocator>
 
   if (counter)
   {
-    if (head + counter > buffer_size
-    || !copy (& storage [head], & buffer [pos], counter) )
-    { brk (); head_locker.unlock (); return false; }
+    if (lhead + counter > (mirrored ? 2 * buffer_size : buffer_size)
+    || !copy (& storage [lhead], & buffer [pos], counter) )
+    { brk (); if (!single_writer) head_locker.unlock (); return false; }
 
-    head += counter;
+    lhead += counter;
 
-    if (head == buffer_size) head = 0;
+    if (lhead >= buffer_size) lhead -= buffer_size;
   }
 
-  head_locker.unlock ();
+  atomic_store_release (& head, lhead); ///< values are visible before head
+
+  if (!single_writer) head_locker.unlock ();
+
+  readable.notify_all ();
   return true;
 }
 
@@ -226,18 +383,15 @@ bool pipe      <Tvalue,       Tsize,       Tlocker,       Tallocator>
   if (!counter)
     return true;
 
-  Tsize used_size, part_size, lhead = head; ///< Head may be changed
+  Tsize part_size, ltail = atomic_load_relaxed (& tail); ///< Tail is changed by reader only
 
-  /// gets the size of the used space
-  if (lhead < tail) ///< :DDDD_H........T_DDDD:
-  {
-    part_size = buffer_size - tail;
-    used_size = part_size + lhead;
-  }
-  else /// (Tail <= lHead) :......T_DDDDD_H......:
+  /// gets the size of the used space by cached head, reread head if it isn't enough
+  Tsize used_size = get_used_size (cached_head, ltail, part_size);
+
+  if (used_size < counter)
   {
-    used_size = lhead - tail;
-    part_size = used_size;
+    cached_head = atomic_load_acquire (& head); ///< writers released values before head
+    used_size = get_used_size (cached_head, ltail, part_size);
   }
 
   if (used_size > buffer_size
@@ -251,13 +405,13 @@ bool pipe      <Tvalue,       Tsize,       Tlocker,       Tallocator>
 
   if (counter > part_size) ///< do cust
   {
-    if ( (tail + part_size) > buffer_size
-      || !copy (& buffer [pos], & storage [tail], part_size) )
+    if ( (ltail + part_size) > buffer_size
+      || !copy (& buffer [pos], & storage [ltail], part_size) )
     { brk (); return false; }
 
-    tail += part_size;
+    ltail += part_size;
 
-    if (tail == buffer_size) tail = 0;
+    if (ltail == buffer_size) ltail = 0;
 
     counter -= part_size;
     pos     += part_size;
@@ -265,15 +419,167 @@ bool pipe      <Tvalue,       Tsize,       Tlocker,       Tallocator>
 
   if (counter)
   {
-    if ( (tail + counter) > buffer_size
-      || !copy (& buffer [pos], & storage [tail], counter) )
+    if ( (ltail + counter) > (mirrored ? 2 * buffer_size : buffer_size)
+      || !copy (& buffer [pos], & storage [ltail], counter) )
     { brk (); return false; }
 
-    tail += counter;
+    ltail += counter;
+
+    if (ltail >= buffer_size) ltail -= buffer_size;
+  }
+
+  atomic_store_release (& tail, ltail); ///< values are copied out before tail
+
+  writable.notify_all ();
+  return true;
+}
+
+/// Gives up to counter free values of storage for writing in place.
+/** \param sp      - free space, it's one or two parts of storage
+  * \param counter - wanted Tvalues counter
+  * \return reserved Tvalues counter, commit_write must be called if it isn't 0. */
+template <class Tvalue, class Tsize, class Tlocker, class Tallocator>
+Tsize pipe     <Tvalue,       Tsize,       Tlocker,       Tallocator>
+
+:: reserve_write (span& sp, Tsize counter)
+{
+  memset (& sp, 0, sizeof (sp) );
+
+  if (!storage || !counter)
+    return 0;
+
+  if (!single_writer) head_locker.lock ();
+
+  Tsize part_size, lhead = atomic_load_relaxed (& head); ///< Head is changed by this writer only
+
+  Tsize free_size = get_free_size (lhead, cached_tail, part_size);
+
+  if (free_size < counter)
+  {
+    cached_tail = atomic_load_acquire (& tail);
+    free_size = get_free_size (lhead, cached_tail, part_size);
+  }
+
+  if (free_size > buffer_size
+   || part_size > buffer_size)
+  { brk (); if (!single_writer) head_locker.unlock (); return 0; }
+
+  if (free_size < counter)
+    counter = free_size;
+
+  if (!counter) ///< pipe buffer is fully used
+  { if (!single_writer) head_locker.unlock (); return 0; }
+
+  sp.part [0] = & storage [lhead];
+  sp.size [0] = counter < part_size ? counter : part_size;
+
+  if (counter > part_size) ///< space is cut by end of cyclo buffer
+  {
+    sp.part [1] = storage;
+    sp.size [1] = counter - part_size;
+  }
+
+  reserved = counter;
+  return counter;
+}
+
+/// Publishes counter values written in reserved space.
+/** \param counter - written Tvalues counter, 0 cancels reserve
+  * \return false if counter is more than reserved space. */
+template <class Tvalue, class Tsize, class Tlocker, class Tallocator>
+bool pipe      <Tvalue,       Tsize,       Tlocker,       Tallocator>
+
+:: commit_write (Tsize counter)
+{
+  if (!reserved) { brk (); return false; } ///< there wasn't reserve_write
+
+  bool rc = true;
+
+  if (counter > reserved)
+  { brk (); counter = 0, rc = false; }
+
+  Tsize lhead = atomic_load_relaxed (& head) + counter;
+
+  if (lhead >= buffer_size) lhead -= buffer_size;
+
+  reserved = 0;
+
+  atomic_store_release (& head, lhead); ///< values are visible before head
+
+  if (!single_writer) head_locker.unlock ();
+
+  if (counter)
+    readable.notify_all ();
+
+  return rc;
+}
+
+/// Gives up to counter stored values for reading in place.
+/** \param sp      - stored values, it's one or two parts of storage
+  * \param counter - wanted Tvalues counter
+  * \return stored Tvalues counter given by sp. */
+template <class Tvalue, class Tsize, class Tlocker, class Tallocator>
+Tsize pipe     <Tvalue,       Tsize,       Tlocker,       Tallocator>
+
+:: peek_read (span& sp, Tsize counter)
+{
+  memset (& sp, 0, sizeof (sp) );
+
+  if (!storage || !counter)
+    return 0;
+
+  Tsize part_size, ltail = atomic_load_relaxed (& tail); ///< Tail is changed by reader only
+
+  Tsize used_size = get_used_size (cached_head, ltail, part_size);
+
+  if (used_size < counter)
+  {
+    cached_head = atomic_load_acquire (& head);
+    used_size = get_used_size (cached_head, ltail, part_size);
+  }
+
+  if (used_size > buffer_size
+   || part_size > buffer_size)
+  { brk (); return 0; }
+
+  if (used_size < counter)
+    counter = used_size;
+
+  sp.part [0] = & storage [ltail];
+  sp.size [0] = counter < part_size ? counter : part_size;
 
-    if (tail == buffer_size) tail = 0;
+  if (counter > part_size) ///< values are cut by end of cyclo buffer
+  {
+    sp.part [1] = storage;
+    sp.size [1] = counter - part_size;
   }
 
+  peeked = counter;
+  return counter;
+}
+
+/// Frees counter values read in place.
+/** \param counter - read Tvalues counter
+  * \return false if counter is more than given by peek_read. */
+template <class Tvalue, class Tsize, class Tlocker, class Tallocator>
+bool pipe      <Tvalue,       Tsize,       Tlocker,       Tallocator>
+
+:: consume (Tsize counter)
+{
+  if (counter > peeked) { brk (); return false; }
+
+  if (!counter)
+    return true;
+
+  Tsize ltail = atomic_load_relaxed (& tail) + counter;
+
+  if (ltail >= buffer_size) ltail -= buffer_size;
+
+  peeked -= counter;
+
+  atomic_store_release (& tail, ltail); ///< values are read out before tail
+
+  writable.notify_all ();
   return true;
 }
 
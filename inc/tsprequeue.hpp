@@ -10,8 +10,8 @@
  *
  *  Classes, methods and structures: \details
  *
- *  External: allocator, queue, multimap
- *  Internal: prequeue
+ *  External: allocator, queue, multimap, eventcount, bprequeue, hprequeue, slprequeue, dqueue
+ *  Internal: prequeue, mprequeue
  *
  *  TODO:		\todo
  *
@@ -22,20 +22,29 @@
 
 #include "tsmap.hpp"
 #include "tsqueue.hpp"
+#include "impl/tsevent.hpp"
+#include "impl/bprequeue.hpp"
+#include "impl/hprequeue.hpp"
+#include "impl/slprequeue.hpp"
+#include "impl/dqueue.hpp"
 
 namespace tstl {
 
+/// Map of queues, queue of prioritet is value of map, it's default engine of prequeue
 template <class Tvalue, class Thash = size_t, class Tallocator = allocator,
-          class Tmultimap = nbmap :: multimap <long, iqueue <Tvalue>*, Thash, Tallocator>,
+          class Tmultimap = nbmap :: multimap <long, queue <Tvalue>*, Thash, Tallocator>,
           class Tmap_pos  = nbmap :: mp>
 
-class prequeue : Tmultimap
+class mprequeue : Tmultimap
 {
   const long alloc_cache_elem;
   long  use_counter;
 
   Tallocator allocator;
 
+  eventcount not_empty; ///< readers of any prioritet wait on it
+  eventcount not_full;  ///< writers wait on it if queue of prioritet is full
+
 public:
   void* operator new (size_t size)
   { Tallocator allocator; return allocator.allocate (size); }
@@ -43,12 +52,12 @@ public:
   void operator delete (void* p)
   { Tallocator allocator; allocator.deallocate (p); }
 
-  prequeue (const long in_alloc_cache_elem = 16,
-            const unsigned long root_array_elems = 32)
-          : Tmultimap (root_array_elems), use_counter (0),
-            alloc_cache_elem (in_alloc_cache_elem) {}
+  mprequeue (const long in_alloc_cache_elem = 16,
+             const unsigned long root_array_elems = 32)
+           : Tmultimap (root_array_elems), use_counter (0),
+             alloc_cache_elem (in_alloc_cache_elem) {}
 
-  ~prequeue ();
+  ~mprequeue ();
 
   /// Is not thread safe method
   bool is_empty () const
@@ -69,6 +78,37 @@ public:
     * \param[in] prioritet is number from 0 to 2^32
     * \return true if Tvalues get from pipe. */
   bool get (Tvalue* buffer, long prioritet = 0);
+
+  /// Stores Tvalues, waits while queue of prioritet is full.
+  /** \param[in] timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if prequeue is closed. */
+  bool put_wait (Tvalue* buffer, long prioritet = 0, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    bool rc = false;
+
+    if (not_full.is_closed () )
+      return false;
+
+    ts_event_wait (not_full, put (buffer, prioritet), timeout, rc);
+    return rc;
+  }
+
+  /// Retrives Tvalues, waits while queue of prioritet is empty.
+  /** \param[in] timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if prequeue is closed and queue of prioritet is empty. */
+  bool get_wait (Tvalue* buffer, long prioritet = 0, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    bool rc = false;
+    ts_event_wait (not_empty, get (buffer, prioritet), timeout, rc);
+    return rc;
+  }
+
+  /// Wake all waiters for shutdown, next put_wait fails at once
+  void close ()
+  {
+    not_full.close ();
+    not_empty.close ();
+  }
 };
 
 /// Stores Tvalues.
@@ -76,13 +116,13 @@ public:
   * \param[in] prioritet is number from 0 to 2^32
   * \return true if Tvalues put into pipe. */
 template <class Tvalue, class Thash, class Tallocator, class Tmultimap, class Tmap_pos>
-bool prequeue  <Tvalue,       Thash,       Tallocator,       Tmultimap,       Tmap_pos>
+bool mprequeue <Tvalue,       Thash,       Tallocator,       Tmultimap,       Tmap_pos>
 
 :: put (Tvalue* buffer, long prioritet)
 {
-  if (!pqueue_map || !buffer) { brk (); return false; }
+  if (!buffer) { brk (); return false; }
 
-  queue <Tvalue>* pq = 0, *ppq = 0;
+  queue <Tvalue>* pq = 0, **ppq = 0;
   Tmap_pos pos;
 
   if (!lookup_by_key (pos, prioritet, ppq) )
@@ -109,14 +149,15 @@ bool prequeue  <Tvalue,       Thash,       Tallocator,       Tmultimap,       Tm
 
   if (!pq->put (buffer) )
   {
-    brk ();
     release (pos);
-    return false;
+    return false; ///< queue of prioritet is full
   }
 
   release (pos);
 
   atomic_inc (& use_counter);
+
+  not_empty.notify_all ();
   return true;
 }
 
@@ -125,17 +166,17 @@ bool prequeue  <Tvalue,       Thash,       Tallocator,       Tmultimap,       Tm
   * \param[in] prioritet is number from 0 to 2^32
   * \return true if Tvalues get from pipe. */
 template <class Tvalue, class Thash, class Tallocator, class Tmultimap, class Tmap_pos>
-bool prequeue  <Tvalue,       Thash,       Tallocator,       Tmultimap,       Tmap_pos>
+bool mprequeue <Tvalue,       Thash,       Tallocator,       Tmultimap,       Tmap_pos>
 
 :: get (Tvalue* buffer, long prioritet)
 {
   if (!buffer) { brk (); return false; }
 
-  queue <Tvalue>* pq = 0, *ppq = 0;
+  queue <Tvalue>* pq = 0, **ppq = 0;
   Tmap_pos pos;
 
   if (!lookup_by_key (pos, prioritet, ppq) )
-  { brk (); return false; }
+    return false; ///< there wasn't any put with prioritet
   else
   if (!ppq || !*ppq)
   {
@@ -155,13 +196,15 @@ bool prequeue  <Tvalue,       Thash,       Tallocator,       Tmultimap,       Tm
   release (pos);
 
   atomic_dec (& use_counter);
+
+  not_full.notify_all ();
   return true;
 }
 
 template <class Tvalue, class Thash, class Tallocator, class Tmultimap, class Tmap_pos>
-prequeue       <Tvalue,       Thash,       Tallocator,       Tmultimap,       Tmap_pos>
+mprequeue      <Tvalue,       Thash,       Tallocator,       Tmultimap,       Tmap_pos>
 
-:: ~prequeue ()
+:: ~mprequeue ()
 {
   Thash hash;
   Tmap_pos pos;
@@ -176,7 +219,8 @@ prequeue       <Tvalue,       Thash,       Tallocator,       Tmultimap,       Tm
 
   do
    {
-    Tmap_pos prev_pos = pos;
+    Tmap_pos prev_pos;
+    prev_pos = pos; ///< assignment doesn't share enumerating array
 
     queue <Tvalue>* pq = 0;
 
@@ -192,6 +236,27 @@ prequeue       <Tvalue,       Thash,       Tallocator,       Tmultimap,       Tm
   while (rc);
 }
 
+/// Priority queue, Tengine keeps messages
+/** Map of queues (mprequeue) is for few prioritets, lock free skip list (slprequeue) is for
+  * sparse prioritets and many threads, it has get_top also. Heap (hprequeue) has get_top
+  * instead of get of exact prioritet. */
+template <class Tvalue, class Thash = size_t, class Tallocator = allocator,
+          class Tmultimap = nbmap :: multimap <long, queue <Tvalue>*, Thash, Tallocator>,
+          class Tmap_pos  = nbmap :: mp,
+          class Tengine   = mprequeue <Tvalue, Thash, Tallocator, Tmultimap, Tmap_pos> >
+
+struct prequeue : Tengine ///< Tengine == mprequeue || slprequeue || hprequeue
+{
+  void* operator new (size_t size)
+  { Tallocator allocator; return allocator.allocate (size); }
+
+  void operator delete (void* p)
+  { Tallocator allocator; allocator.deallocate (p); }
+
+  prequeue (const long alloc_cache_elem = 16, const unsigned long root_array_elems = 32)
+          : Tengine (alloc_cache_elem, root_array_elems) {}
+};
+
 }; /* end of tstl namespace */
 
 #endif /* __TSPREQUEUE_HPP__ */
@@ -10,7 +10,7 @@
  *
  *  Classes, methods and structures: \details
  *
- *  External: allocator, alloc_cache, melocker (relocker)
+ *  External: allocator, alloc_cache, melocker (relocker), iqueue, cqueue, rqueue, pipe, epipe, eventcount
  *  Internal: queue
  *
  *  TODO:		\todo
@@ -23,15 +23,21 @@
 #include "tspipe.hpp"
 
 #include "impl/cqueue.hpp"
+#include "impl/epipe.hpp"
 #include "impl/iqueue.hpp"
+#include "impl/rqueue.hpp"
+#include "impl/tsevent.hpp"
 
 namespace tstl {
 
 template <class Tvalue, class Tallocator = allocator,
           class Tqueue = iqueue <Tvalue, melocker<>, Tallocator> >
 
-struct queue : Tqueue ///< Tqueue == iqueue || cqueue || pipe
+struct queue : Tqueue ///< Tqueue == iqueue || cqueue || pipe || epipe || rqueue
 {
+  eventcount not_empty; ///< readers wait on it
+  eventcount not_full;  ///< writers wait on it
+
   void* operator new (size_t size)
   { Tallocator allocator; return allocator.allocate (size); }
 
@@ -52,13 +58,82 @@ struct queue : Tqueue ///< Tqueue == iqueue || cqueue || pipe
   /** \param[in] buffer is pointer to Tvalues
     * \return true if Tvalues put into pipe. */
   bool put (Tvalue* buffer)
-  { return Tqueue :: put (buffer); }
+  {
+    if (!Tqueue :: put (buffer) )
+      return false;
+
+    not_empty.notify_all ();
+    return true;
+  }
 
   /// Retrives Tvalues.
   /** \param[in] buffer is pointer to Tvalues
     * \return true if Tvalues get from pipe. */
   bool get (Tvalue* buffer)
-  { return Tqueue :: get (buffer); }
+  {
+    if (!Tqueue :: get (buffer) )
+      return false;
+
+    not_full.notify_all ();
+    return true;
+  }
+
+  /// Stores batch of Tvalues, Tqueue is iqueue or cqueue.
+  /** \param[in] buffer is array of counter Tvalues
+    * \return number of Tvalues put into queue. */
+  long put_bulk (const Tvalue* buffer, const long counter)
+  {
+    long rc = Tqueue :: put_bulk (buffer, counter);
+
+    if (rc)
+      not_empty.notify_all ();
+
+    return rc;
+  }
+
+  /// Retrives up to counter Tvalues, Tqueue is iqueue or cqueue.
+  /** \param[in] buffer is array of counter Tvalues
+    * \return number of Tvalues get from queue. */
+  long get_bulk (Tvalue* buffer, const long counter)
+  {
+    long rc = Tqueue :: get_bulk (buffer, counter);
+
+    if (rc)
+      not_full.notify_all ();
+
+    return rc;
+  }
+
+  /// Stores Tvalues, waits while queue is full.
+  /** \param[in] timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if queue is closed. */
+  bool put_wait (Tvalue* buffer, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    bool rc = false;
+
+    if (not_full.is_closed () )
+      return false;
+
+    ts_event_wait (not_full, put (buffer), timeout, rc);
+    return rc;
+  }
+
+  /// Retrives Tvalues, waits while queue is empty.
+  /** \param[in] timeout is in milliseconds, TS_INFINITE_TIMEOUT means forever
+    * \return false on timeout or if queue is closed and empty. */
+  bool get_wait (Tvalue* buffer, long timeout = TS_INFINITE_TIMEOUT)
+  {
+    bool rc = false;
+    ts_event_wait (not_empty, get (buffer), timeout, rc);
+    return rc;
+  }
+
+  /// Wake all waiters for shutdown, next put_wait fails at once
+  void close ()
+  {
+    not_full.close ();
+    not_empty.close ();
+  }
 };
 
 template <class Tqueue>
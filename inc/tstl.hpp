@@ -11,7 +11,7 @@
  *  Classes, methods and structures: \details
  *
  *  External: new, delete
- *  Internal: allocator
+ *  Internal: allocator, value_traits, TS_POD_TYPE
  *
  *  TODO: 		\todo
  *
@@ -29,6 +29,7 @@
 #define TS_SPINLOCK_COUNTER 500
 #define TS_MINUS_MEDIAN	 0x1000
 #define TS_MINUS_NULL	 ( (long)(0 - TS_MINUS_MEDIAN) )
+#define TS_CACHE_LINE_SIZE 64
 
 /// Make signature from chars
 #define TS_LONG_SIGNATURE(A, B, C, D) ( ( (unsigned long) (D) << 24) \
@@ -39,6 +40,7 @@
 /// Objects Status Definition Signatures (OSDS)
 #define TS_FREE_SIGN TS_LONG_SIGNATURE ('F','R','E','E') ///< ready for using
 #define TS_BUSY_SIGN TS_LONG_SIGNATURE ('B','U','S','Y') ///< busy, in change time
+#define TS_WAIT_SIGN TS_LONG_SIGNATURE ('W','A','I','T') ///< busy and has parked waiters
 #define TS_LIVE_SIGN TS_LONG_SIGNATURE ('L','I','V','E') ///< has usefull payload
 #define TS_KILL_SIGN TS_LONG_SIGNATURE ('K','I','L','L') ///< killing time status
 #define TS_DEAD_SIGN TS_LONG_SIGNATURE ('D','E','A','D') ///< dead but partialy undestroyed
@@ -54,6 +56,25 @@ struct allocator
   void deallocate (void* p)     { delete [] p; }
 };
 
+/// Value traits, is_pod values could be copied by memcpy
+/** Declare own plain structures by TS_POD_TYPE (type) in tstl namespace */
+template <class T> struct value_traits      { enum { is_pod = 0 }; };
+template <class T> struct value_traits <T*> { enum { is_pod = 1 }; };
+
+#define TS_POD_TYPE(T) template <> struct value_traits <T> { enum { is_pod = 1 }; }
+
+TS_POD_TYPE (char);
+TS_POD_TYPE (signed char);
+TS_POD_TYPE (unsigned char);
+TS_POD_TYPE (short);
+TS_POD_TYPE (unsigned short);
+TS_POD_TYPE (int);
+TS_POD_TYPE (unsigned int);
+TS_POD_TYPE (long);
+TS_POD_TYPE (unsigned long);
+TS_POD_TYPE (float);
+TS_POD_TYPE (double);
+
 }; /* end of tstl namespace */
 
 static inline void* _cdecl operator new (size_t, void *_P, const tstl :: allocator& allocator)
@@ -68,15 +89,19 @@ static inline void* _cdecl operator new (size_t, void *_P, const tstl :: allocat
    || defined (__TSQUEUE_HPP__)	\
    || defined (__TSPREQUEUE_HPP__)\
    || defined (__TSPIPE_HPP__)	\
+   || defined (__TSMSGPIPE_HPP__)\
+   || defined (__TSEXECUTOR_HPP__)\
    || defined (__RWLOCKER_HPP__)\
    || defined (__RELOCKER_HPP__)\
    || defined (__MELOCKER_HPP__) )
 
 #  include "tspipe.hpp"		///< includes relocker.hpp
+#  include "tsmsgpipe.hpp"	///< includes tspipe.hpp
 #  include "tscache.hpp"	///< includes limitcache.hpp -> tsmap.hpp, timercache.hpp
 #  include "tsqueue.hpp"	///< includes relocker.hpp, alloccache.hpp
 #  include "rwlocker.hpp"	///< includes relocker.hpp -> melocker.hpp
 #  include "tsprequeue.hpp"	///< includes tsmap.hpp, tsqueue.hpp
+#  include "tsexecutor.hpp"	///< includes tsqueue.hpp, wsdeque.hpp
 
 #endif ///< Include all library templates if was not specified before one of them
 
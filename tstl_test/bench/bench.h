@@ -0,0 +1,76 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file bench.h
+ *
+ *  Abstract:		\brief Common routines of TSTL benchmarks: threads, timer and arguments.
+ *
+ *  Author:	    	\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Benchmark includes tested template before this file, so tstl.hpp doesn't pull all library.
+ *
+ *  External: thread_create, thread_join, monotonic_time
+ *  Internal: tstl_bench :: run_threads, tstl_bench :: bench_arg, tstl_bench :: per_second
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined (WIN32)
+#  include <windows.h>
+#endif
+
+#include "tstl.hpp"
+#include "impl/tsthread.h"
+#include "impl/tstime.h"
+
+#define BENCH_MAX_THREADS 64
+
+namespace tstl_bench {
+
+using namespace tstl;
+
+typedef ts_thread_return (TS_THREAD_CALL *bench_routine) (void* context);
+
+/// Run routine (context) by number of threads and wait for all of them
+/** \return milliseconds from start of first thread till end of last one */
+static inline ulonglong run_threads (const bench_routine routine, void* context, long number)
+{
+  ts_thread_handle threads [BENCH_MAX_THREADS];
+
+  if (number > BENCH_MAX_THREADS)
+    number = BENCH_MAX_THREADS;
+
+  ulonglong start = monotonic_time ();
+  long started = 0;
+
+  for (; started < number; started++)
+    if (!thread_create (threads [started], routine, context) )
+    { printf ("thread %ld isn't started\n", started); break; }
+
+  for (long i = 0; i < started; i++)
+    thread_join (threads [i]);
+
+  return monotonic_time () - start;
+}
+
+/// Numeric argument or default value
+static inline long bench_arg (int argc, char** argv, const int index, const long value)
+{ return index < argc ? atol (argv [index]) : value; }
+
+/// Millions of operations per second
+static inline double per_second (const double operations, const ulonglong ms)
+{ return ms ? operations / ms / 1000. : 0.; }
+
+}; /* end of tstl_bench namespace */
+
+#endif /* __BENCH_H__ */
@@ -0,0 +1,77 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file bench_mutex.cpp
+ *
+ *  Abstract:		\brief Contention benchmark of mutexes: native, spinlock, fastlock and futexlock.
+ *
+ *  Author:	    	\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Usage: bench_mutex [threads] [iterations per thread]
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#include "impl/melocker.hpp"
+
+#include "bench.h"
+
+using namespace tstl_bench;
+
+/// Threads lock mutex, increment shared counter and unlock it
+template <class Tlocker>
+
+struct mutex_test
+{
+  Tlocker locker;
+  volatile long counter;
+  long iterations;
+
+  mutex_test (const long in_iterations) : counter (0), iterations (in_iterations) {}
+
+  static ts_thread_return TS_THREAD_CALL routine (void* context)
+  {
+    mutex_test* pt = (mutex_test*) context;
+
+    for (long i = 0; i < pt->iterations; i++)
+    {
+      pt->locker.lock ();
+      pt->counter++;
+      pt->locker.unlock ();
+    }
+
+    return 0;
+  }
+};
+
+template <class Tlocker>
+static void run (const char* name, const long threads, const long iterations)
+{
+  mutex_test <Tlocker> test (iterations);
+
+  ulonglong ms = run_threads (mutex_test <Tlocker> :: routine, & test, threads);
+
+  printf ("%-10s threads %3ld: %6llu ms, %7.2f Mops/s, counter %s\n", name, threads, ms,
+          per_second ( (double) threads * iterations, ms),
+          test.counter == threads * iterations ? "exact" : "BROKEN");
+}
+
+int main (int argc, char** argv)
+{
+  long threads    = bench_arg (argc, argv, 1, 8);
+  long iterations = bench_arg (argc, argv, 2, 1000000);
+
+  for (long t = 1; t <= threads; t <<= 1)
+  {
+    run <mutex>              ("native",    t, iterations); ///< pthread_mutex.hpp or win32_mutex.hpp
+    run <spinlock :: mutex>  ("spinlock",  t, iterations);
+    run <fastlock :: mutex>  ("fastlock",  t, iterations);
+    run <futexlock :: mutex> ("futexlock", t, iterations);
+  }
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file bench_nbmap.cpp
+ *
+ *  Abstract:		\brief Lookup benchmark of nbmap with 100M keys.
+ *
+ *  Author:	    	\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Usage: bench_nbmap [keys] [threads] [lookups per thread]
+ *
+ *  Map is filled by keys 0..keys-1, then threads look for random keys by lookup_by_key with
+ *  release and by copy_by_key. It's classic layout of map element, bench_nbmap_compact is
+ *  same benchmark built with NB_MAP_COMPACT_LAYOUT.
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#include "tsmap.hpp"
+
+#include "bench.h"
+
+using namespace tstl_bench;
+
+typedef nbmap :: multimap <unsigned long, unsigned long> map_type;
+
+#if defined (NB_MAP_COMPACT_LAYOUT)
+#  define BENCH_LAYOUT "compact"
+#else
+#  define BENCH_LAYOUT "classic"
+#endif
+
+/// Threads look for random keys, value of key is key itself
+struct lookup_test
+{
+  map_type* pmap;
+  unsigned long keys;
+  long lookups;
+  bool copy;
+
+  volatile long seeds;
+  volatile long missed;
+
+  lookup_test (map_type* in_pmap, const unsigned long in_keys, const long in_lookups, const bool in_copy)
+             : pmap (in_pmap), keys (in_keys), lookups (in_lookups), copy (in_copy), seeds (0), missed (0) {}
+
+  static ts_thread_return TS_THREAD_CALL routine (void* context)
+  {
+    lookup_test* pt = (lookup_test*) context;
+    unsigned long random = 0x9e3779b9UL * (unsigned long) atomic_inc_return ( (long*) & pt->seeds);
+    long missed = 0;
+
+    for (long i = 0; i < pt->lookups; i++)
+    {
+      random ^= random << 13, random ^= random >> 17, random ^= random << 5; ///< xorshift
+
+      unsigned long key = random % pt->keys;
+      unsigned long value = ~key;
+
+      if (pt->copy)
+      {
+        if (!pt->pmap->copy_by_key (key, & value) )
+          value = ~key;
+      }
+      else
+      {
+        mp pos;
+        unsigned long* pvalue;
+
+        if (pt->pmap->lookup_by_key (pos, key, pvalue) )
+          value = *pvalue, pt->pmap->release (pos);
+      }
+
+      if (value != key)
+        missed++;
+    }
+
+    atomic_add_return ( (long*) & pt->missed, missed);
+    return 0;
+  }
+};
+
+static void run (const char* name, map_type* pmap, const unsigned long keys, const long threads, const long lookups, const bool copy)
+{
+  lookup_test test (pmap, keys, lookups, copy);
+
+  ulonglong ms = run_threads (lookup_test :: routine, & test, threads);
+
+  printf ("%s %-7s threads %3ld: %6llu ms, %7.2f Mlookups/s, missed %ld\n", BENCH_LAYOUT, name, threads, ms,
+          per_second ( (double) threads * lookups, ms), test.missed);
+}
+
+int main (int argc, char** argv)
+{
+  unsigned long keys = (unsigned long) bench_arg (argc, argv, 1, 100000000);
+  long threads       = bench_arg (argc, argv, 2, 8);
+  long lookups       = bench_arg (argc, argv, 3, 10000000);
+
+  if (!keys) { printf ("wrong keys number\n"); return 1; }
+
+  map_type* pmap = new map_type ();
+
+  if (!pmap) { printf ("map isn't created\n"); return 1; }
+
+  ulonglong start = monotonic_time ();
+  unsigned long key = 0;
+
+  for (; key < keys; key++)
+  {
+    mp pos;
+
+    if (!pmap->set_at (pos, key, & key) )
+      break;
+
+    pmap->release (pos);
+  }
+
+  printf ("%s map of %lu keys is filled for %llu ms\n", BENCH_LAYOUT, key, monotonic_time () - start);
+
+  if (key == keys)
+  {
+    for (long t = 1; t <= threads; t <<= 1)
+    {
+      run ("lookup", pmap, keys, t, lookups, false);
+      run ("copy",   pmap, keys, t, lookups, true);
+    }
+  }
+
+  delete pmap;
+  return key == keys ? 0 : 1;
+}
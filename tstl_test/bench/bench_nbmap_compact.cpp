@@ -0,0 +1,21 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file bench_nbmap_compact.cpp
+ *
+ *  Abstract:		\brief Lookup benchmark of nbmap with compact layout of map element.
+ *
+ *  Author:	    	\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Usage: bench_nbmap_compact [keys] [threads] [lookups per thread]
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#define NB_MAP_COMPACT_LAYOUT
+
+#include "bench_nbmap.cpp"
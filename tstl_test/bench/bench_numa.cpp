@@ -0,0 +1,114 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file bench_numa.cpp
+ *
+ *  Abstract:		\brief Benchmark of NUMA local numa_alloc_cache against one iqalloc_cache.
+ *
+ *  Author:	    	\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Usage: bench_numa [threads] [rounds] [block size]
+ *
+ *  Threads get batch of blocks, write every byte of them and revert batch. One iqalloc_cache
+ *  keeps storage on node of constructing thread, aligned cache doesn't share cache lines
+ *  between blocks, numa_alloc_cache gives blocks of node of calling thread. Build it with
+ *  -DTS_ALLOC_CACHE_PADDING to see padding of control fields. Threads are spread over nodes
+ *  by scheduler, it's run on 2 sockets machine for the effect.
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#include "alloccache.hpp"
+
+#include "bench.h"
+
+using namespace tstl_bench;
+
+#define BATCH_SIZE 64
+
+template <class Tcache>
+
+struct numa_test
+{
+  Tcache* pcache;
+  long rounds;
+  size_t block_size;
+
+  volatile long errors;
+  volatile long empty;
+  volatile long blocks;
+
+  numa_test (Tcache* in_pcache, const long in_rounds, const size_t in_block_size)
+           : pcache (in_pcache), rounds (in_rounds), block_size (in_block_size), errors (0), empty (0), blocks (0) {}
+
+  static ts_thread_return TS_THREAD_CALL routine (void* context)
+  {
+    numa_test* pt = (numa_test*) context;
+    char* batch [BATCH_SIZE];
+
+    for (long round = 0; round < pt->rounds; round++)
+    {
+      long got = 0;
+
+      for (; got < BATCH_SIZE; got++)
+      {
+        if (0 == (batch [got] = pt->pcache->get (pt->block_size) ) )
+        { atomic_inc ( (long*) & pt->empty); break; } ///< try counter is exceeded
+
+        memset (batch [got], (int) round, pt->block_size);
+      }
+
+      for (long i = 0; i < got; i++)
+        if (!pt->pcache->revert (batch [i]) )
+          atomic_inc ( (long*) & pt->errors);
+
+      atomic_add_return ( (long*) & pt->blocks, got);
+    }
+
+    return 0;
+  }
+};
+
+template <class Tcache>
+static void run (const char* name, Tcache* pcache, const long threads, const long rounds, const size_t block_size)
+{
+  if (!pcache) { printf ("%-10s isn't created\n", name); return; }
+
+  numa_test <Tcache> test (pcache, rounds, block_size);
+
+  ulonglong ms = run_threads (numa_test <Tcache> :: routine, & test, threads);
+
+  printf ("%-10s threads %3ld: %6llu ms, %7.2f Mblocks/s, empty %ld, errors %ld\n", name, threads, ms,
+          per_second ( (double) test.blocks, ms), test.empty, test.errors);
+
+  delete pcache;
+}
+
+int main (int argc, char** argv)
+{
+  long threads      = bench_arg (argc, argv, 1, 16);
+  long rounds       = bench_arg (argc, argv, 2, 20000);
+  size_t block_size = (size_t) bench_arg (argc, argv, 3, 200);
+
+  long blocks = 2 * threads * BATCH_SIZE;
+
+  printf ("numa nodes %ld, node of main thread %ld\n", numa_nodes_number (), current_numa_node () );
+
+  for (long t = 1; t <= threads; t <<= 1)
+  {
+    run ("iqalloc", new iqalloc_cache <char> (block_size, blocks, TS_MAX_TRY_COUNTER, true),
+         t, rounds, block_size);
+
+    run ("aligned", new iqalloc_cache <char> (block_size, blocks, TS_MAX_TRY_COUNTER, true, 0, true),
+         t, rounds, block_size);
+
+    run ("numa", new numa_alloc_cache <char> (block_size, blocks, TS_MAX_TRY_COUNTER, true),
+         t, rounds, block_size);
+  }
+
+  return 0;
+}
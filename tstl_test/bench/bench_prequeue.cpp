@@ -0,0 +1,176 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file bench_prequeue.cpp
+ *
+ *  Abstract:		\brief Benchmark of slprequeue against prequeue and hprequeue at 1, 8 and 64 threads.
+ *
+ *  Author:	    	\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Usage: bench_prequeue [threads] [rounds] [depth] [prioritets]
+ *
+ *  Every thread puts depth values, then does rounds of put and get, then gets depth values
+ *  back. Queues are prequeue with different engines. Exact test gets by prioritet of own
+ *  range of prioritets, it's map of queues (mprequeue) against skip list (slprequeue) get.
+ *  Top test puts deadlines (round plus random delay) and gets most urgent value, it's heap
+ *  under lock (hprequeue) against skip list get_top. Sums of put and got values are compared.
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#include "tsprequeue.hpp"
+
+#include "bench.h"
+
+using namespace tstl_bench;
+
+typedef nbmap :: multimap <long, queue <long>*> map_type;
+
+typedef prequeue <long> map_prequeue;
+typedef prequeue <long, size_t, allocator, map_type, nbmap :: mp, slprequeue <long> > skip_list_prequeue;
+typedef prequeue <long, size_t, allocator, map_type, nbmap :: mp, hprequeue <long> >  heap_prequeue;
+
+/// Get by prioritet of put value
+struct exact_get
+{
+  static long prioritet (const long base, const long prioritets, const long round, unsigned long&)
+  { return base + round % prioritets; }
+
+  template <class Tqueue>
+  static bool get (Tqueue* pqueue, long* pvalue, const long prioritet)
+  { return pqueue->get (pvalue, prioritet); }
+};
+
+/// Get most urgent value, prioritets are deadlines
+struct top_get
+{
+  static long prioritet (const long, const long, const long round, unsigned long& random)
+  {
+    random ^= random << 13, random ^= random >> 17, random ^= random << 5; ///< xorshift
+    return round + (long) (random % 1000);
+  }
+
+  template <class Tqueue>
+  static bool get (Tqueue* pqueue, long* pvalue, const long)
+  { return pqueue->get_top (pvalue); }
+};
+
+template <class Tqueue, class Tget>
+
+struct prequeue_test
+{
+  Tqueue* pqueue;
+  long rounds;
+  long depth;
+  long prioritets;
+
+  volatile long threads;
+  volatile long errors;
+  volatile long empty;
+  volatile long put_sum;
+  volatile long got_sum;
+
+  prequeue_test (Tqueue* in_pqueue, const long in_rounds, const long in_depth, const long in_prioritets)
+               : pqueue (in_pqueue), rounds (in_rounds), depth (in_depth), prioritets (in_prioritets),
+                 threads (0), errors (0), empty (0), put_sum (0), got_sum (0) {}
+
+  /// Get one value, other threads could take all values of top for a while
+  bool get_one (long* pvalue, const long prioritet, long& empty)
+  {
+    for (long i = 0; i < TS_MAX_TRY_COUNTER; i++)
+    {
+      if (Tget :: get (pqueue, pvalue, prioritet) )
+        return true;
+
+      empty++;
+      ts_yield_processor ();
+    }
+
+    return false;
+  }
+
+  static ts_thread_return TS_THREAD_CALL routine (void* context)
+  {
+    prequeue_test* pt = (prequeue_test*) context;
+    long index = atomic_inc_return ( (long*) & pt->threads) - 1;
+
+    long base = index * pt->prioritets;
+    unsigned long random = 0x9e3779b9UL * (unsigned long) (index + 1);
+    unsigned long put_sum = 0, got_sum = 0;
+    long errors = 0, empty = 0, value = 0;
+
+    for (long round = 0; round < pt->rounds + pt->depth; round++)
+    {
+      if (round < pt->rounds)
+      {
+        value = round + 1;
+
+        if (!pt->pqueue->put (& value, Tget :: prioritet (base, pt->prioritets, round, random) ) )
+          errors++;
+        else
+          put_sum += value;
+      }
+
+      if (round < pt->depth)
+        continue; ///< queue is filled by depth values first
+
+      /// value put depth rounds ago is got
+      if (!pt->get_one (& value, Tget :: prioritet (base, pt->prioritets, round - pt->depth, random), empty) )
+      { errors++; continue; }
+
+      got_sum += value;
+    }
+
+    atomic_add_return ( (long*) & pt->put_sum, (long) put_sum);
+    atomic_add_return ( (long*) & pt->got_sum, (long) got_sum);
+    atomic_add_return ( (long*) & pt->errors, errors);
+    atomic_add_return ( (long*) & pt->empty, empty);
+    return 0;
+  }
+};
+
+template <class Tget, class Tqueue>
+static bool run (const char* name, Tqueue* pqueue, const long threads, const long rounds, const long depth, const long prioritets)
+{
+  if (!pqueue) { printf ("%-11s isn't created\n", name); return false; }
+
+  prequeue_test <Tqueue, Tget> test (pqueue, rounds, depth, prioritets);
+
+  ulonglong ms = run_threads (prequeue_test <Tqueue, Tget> :: routine, & test, threads);
+
+  bool exact = test.put_sum == test.got_sum && !test.errors;
+
+  printf ("%-11s threads %3ld: %6llu ms, %7.2f Mops/s, empty %ld, errors %ld, sum %s\n", name, threads, ms,
+          per_second (2. * threads * rounds, ms), test.empty, test.errors, exact ? "exact" : "BROKEN");
+
+  delete pqueue;
+  return exact;
+}
+
+int main (int argc, char** argv)
+{
+  long threads    = bench_arg (argc, argv, 1, 64);
+  long rounds     = bench_arg (argc, argv, 2, 100000);
+  long depth      = bench_arg (argc, argv, 3, 64);
+  long prioritets = bench_arg (argc, argv, 4, 16);
+
+  if (threads > BENCH_MAX_THREADS || threads <= 0 || depth < 0 || depth > rounds || prioritets <= 0)
+  { printf ("wrong arguments\n"); return 1; }
+
+  bool ok = true;
+
+  for (long t = 1; t <= threads; t <<= 3)
+  {
+    ok &= run <exact_get> ("mprequeue",  new map_prequeue (),       t, rounds, depth, prioritets);
+    ok &= run <exact_get> ("slprequeue", new skip_list_prequeue (), t, rounds, depth, prioritets);
+    ok &= run <top_get>   ("hprequeue",  new heap_prequeue (),      t, rounds, depth, prioritets);
+    ok &= run <top_get>   ("slprequeue", new skip_list_prequeue (), t, rounds, depth, prioritets);
+  }
+
+  printf ("%s\n", ok ? "passed" : "FAILED");
+  return ok ? 0 : 1;
+}
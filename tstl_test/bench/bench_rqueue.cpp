@@ -0,0 +1,117 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file bench_rqueue.cpp
+ *
+ *  Abstract:		\brief Producers and consumers benchmark of rqueue against iqueue, cqueue and pipe.
+ *
+ *  Author:	    	\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Usage: bench_rqueue [producers] [consumers] [values per producer]
+ *
+ *  Pipe has one reader always, so it's measured with one consumer.
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#include "tsqueue.hpp"
+
+#include "bench.h"
+
+using namespace tstl_bench;
+
+/// First consumers threads get values, other threads put them, sum of values is checked
+template <class Tqueue>
+
+struct queue_test
+{
+  Tqueue* pqueue;
+  long producers;
+  long consumers;
+  long values;
+
+  volatile long started;
+  volatile long consumed;
+  volatile long sum;
+
+  queue_test (Tqueue* in_pqueue, const long in_producers, const long in_consumers, const long in_values)
+            : pqueue (in_pqueue), producers (in_producers), consumers (in_consumers), values (in_values),
+              started (0), consumed (0), sum (0) {}
+
+  static ts_thread_return TS_THREAD_CALL routine (void* context)
+  {
+    queue_test* pt = (queue_test*) context;
+
+    if (atomic_inc_return ( (long*) & pt->started) <= pt->consumers)
+    {
+      long total = pt->producers * pt->values;
+      unsigned long local = 0;
+
+      while (pt->consumed < total)
+      {
+        long value;
+
+        if (!pt->pqueue->get (& value) )
+        { ts_yield_processor (); continue; }
+
+        local += value;
+        atomic_inc ( (long*) & pt->consumed);
+      }
+
+      atomic_add_return ( (long*) & pt->sum, (long) local);
+    }
+    else
+    {
+      for (long value = 1; value <= pt->values; value++)
+        while (!pt->pqueue->put (& value) )
+          ts_yield_processor (); ///< bounded queue is full
+    }
+
+    return 0;
+  }
+};
+
+template <class Tqueue>
+static void run (const char* name, Tqueue* pqueue, const long producers, const long consumers, const long values)
+{
+  if (!pqueue) { printf ("%-8s isn't created\n", name); return; }
+
+  queue_test <Tqueue> test (pqueue, producers, consumers, values);
+
+  ulonglong ms = run_threads (queue_test <Tqueue> :: routine, & test, producers + consumers);
+
+  /// sum of 1..values by every producer, it's wrapped as unsigned long on both sides
+  unsigned long expected = values & 1 ? (unsigned long) values * ( (values + 1) / 2)
+                                      : (unsigned long) (values / 2) * (values + 1);
+
+  printf ("%-8s %3ld:%-3ld %6llu ms, %7.2f Mops/s, sum %s\n", name, producers, consumers, ms,
+          per_second ( (double) producers * values, ms),
+          (unsigned long) test.sum == expected * producers ? "exact" : "BROKEN");
+
+  delete pqueue;
+}
+
+int main (int argc, char** argv)
+{
+  long producers = bench_arg (argc, argv, 1, 4);
+  long consumers = bench_arg (argc, argv, 2, 4);
+  long values    = bench_arg (argc, argv, 3, 1000000);
+
+  if (producers + consumers > BENCH_MAX_THREADS || producers <= 0 || consumers <= 0)
+  { printf ("wrong threads number\n"); return 1; }
+
+  run ("rqueue", new rqueue <long> (0x1000),      producers, consumers, values);
+  run ("iqueue", new iqueue <long> (0x1000, true), producers, consumers, values);
+  run ("cqueue", new cqueue <long> (0x1000),      producers, consumers, values);
+
+  run ("rqueue", new rqueue <long> (0x1000),      producers, 1, values);
+  run ("iqueue", new iqueue <long> (0x1000),      producers, 1, values);
+  run ("cqueue", new cqueue <long> (0x1000),      producers, 1, values);
+  run ("pipe",   new tstl :: pipe <long> (0x1000, 1 == producers), producers, 1, values);
+
+  return 0;
+}
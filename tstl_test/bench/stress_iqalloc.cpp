@@ -0,0 +1,148 @@
+/*****************************************************************************************************//**
+ *
+ *  Module Name:	\file stress_iqalloc.cpp
+ *
+ *  Abstract:		\brief Stress test of iqalloc_cache with 10M blocks.
+ *
+ *  Author:	    	\author Vyacheslav I. Levtchenko (mail-to: slavalev@gmail.com)
+ *
+ *  Revision History:	\date 17.10.2026 started
+ *
+ *  Classes, methods and structures: \details
+ *
+ *  Usage: stress_iqalloc [blocks] [threads] [rounds]
+ *
+ *  All blocks are got once and every block must be unique (one block is dummy of queue),
+ *  then threads get and revert blocks with owner marks, so block given twice or lost block
+ *  is found.
+ *
+ *  TODO:		\todo
+ *
+ *********************************************************************************************************/
+
+#include "alloccache.hpp"
+
+#include "bench.h"
+
+using namespace tstl_bench;
+
+typedef iqalloc_cache <char> cache_type;
+
+#define BLOCK_SIZE  16
+#define BATCH_SIZE  1000
+
+/// Every thread gets batch of blocks, marks them by own number, checks marks and reverts batch
+struct stress_test
+{
+  cache_type* pcache;
+  long rounds;
+
+  volatile long threads;
+  volatile long errors;
+  volatile long empty;
+
+  stress_test (cache_type* in_pcache, const long in_rounds)
+             : pcache (in_pcache), rounds (in_rounds), threads (0), errors (0), empty (0) {}
+
+  static ts_thread_return TS_THREAD_CALL routine (void* context)
+  {
+    stress_test* pt = (stress_test*) context;
+    long mark = atomic_inc_return ( (long*) & pt->threads);
+
+    char* batch [BATCH_SIZE];
+
+    for (long round = 0; round < pt->rounds; round++)
+    {
+      long got = 0;
+
+      for (; got < BATCH_SIZE; got++)
+      {
+        if (0 == (batch [got] = pt->pcache->get (BLOCK_SIZE) ) )
+        { atomic_inc ( (long*) & pt->empty); break; }
+
+        if (* (long*) batch [got])
+          atomic_inc ( (long*) & pt->errors); ///< block is owned by other thread
+
+        * (long*) batch [got] = mark;
+      }
+
+      for (long i = 0; i < got; i++)
+      {
+        if (mark != * (long*) batch [i])
+          atomic_inc ( (long*) & pt->errors);
+
+        * (long*) batch [i] = 0;
+
+        if (!pt->pcache->revert (batch [i]) )
+          atomic_inc ( (long*) & pt->errors);
+      }
+    }
+
+    return 0;
+  }
+};
+
+int main (int argc, char** argv)
+{
+  long blocks  = bench_arg (argc, argv, 1, 10000000);
+  long threads = bench_arg (argc, argv, 2, 8);
+  long rounds  = bench_arg (argc, argv, 3, 1000);
+
+  ulonglong start = monotonic_time ();
+
+  cache_type* pcache = new cache_type (BLOCK_SIZE, blocks, TS_MAX_TRY_COUNTER, true);
+
+  if (!pcache) { printf ("cache isn't created\n"); return 1; }
+
+  printf ("cache of %ld blocks is made for %llu ms\n", blocks, monotonic_time () - start);
+
+  /// all blocks are unique, block index is written into block
+  char** all = (char**) malloc (sizeof (char*) * blocks);
+  long got = 0, errors = 0;
+
+  if (!all) { printf ("there isn't memory for test\n"); delete pcache; return 1; }
+
+  start = monotonic_time ();
+
+  for (; got < blocks; got++)
+  {
+    if (0 == (all [got] = pcache->get (BLOCK_SIZE) ) )
+      break;
+
+    * (long*) all [got] = got + 1;
+  }
+
+  if (pcache->get (BLOCK_SIZE) )
+    errors++; ///< cache gives more blocks than it has
+
+  for (long i = 0; i < got; i++)
+    if (* (long*) all [i] != i + 1)
+      errors++;
+
+  for (long i = 0; i < got; i++)
+  {
+    * (long*) all [i] = 0;
+
+    if (!pcache->revert (all [i]) )
+      errors++;
+  }
+
+  printf ("got %ld of %ld - 1 blocks and reverted them for %llu ms, errors %ld\n",
+          got, blocks, monotonic_time () - start, errors);
+
+  free (all);
+
+  stress_test test (pcache, rounds);
+
+  ulonglong ms = run_threads (stress_test :: routine, & test, threads);
+
+  printf ("threads %ld: %llu ms, %7.2f Mops/s, empty %ld, errors %ld, used %ld\n", threads, ms,
+          per_second (2. * threads * rounds * BATCH_SIZE, ms), test.empty, test.errors, pcache->get_stat () );
+
+  bool ok = got == blocks - 1 && !errors && !test.errors && pcache->is_empty ();
+
+  delete pcache;
+
+  printf ("%s\n", ok ? "passed" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+#################################################################################
+#
+#  Module Name:		linux_check.sh
+#
+#  Author:		Slava I. Levtchenko <slavalev@gmail.com>
+#
+#  Abstract:		syntax check of Linux user mode platform headers (futex,
+#			membarrier, threads, NUMA, mirror) by g++
+#
+#  Revision History:	17.10.2026 started
+#
+#################################################################################
+
+CXX=${CXX:-g++}
+INC=`dirname $0`/../inc
+HEADERS="impl/tsdebug.h impl/tsatomic.h impl/tsfutex.h impl/tsthread.h impl/tsnuma.h impl/tsmirror.h"
+RC=0
+
+for FLAGS in "" "-DDEBUG"; do
+  for H in $HEADERS; do
+    if ! echo "#include \"$H\"" | $CXX -fsyntax-only $FLAGS -I $INC -x c++ - ; then
+      echo "$H $FLAGS: FAILED"
+      RC=1
+    fi
+  done
+done
+
+exit $RC
@@ -30,6 +30,7 @@ OUTDOX = $(OUTROOT)doxygen\\
 OUTDOX = $(OUTDOX:\\=\)
 
 APP  = .\app\\
+BENCH = .\bench\\
 CI   = .\inc\\
 CFGS = .\cfg\\
 DOC  = .\doc\\
@@ -39,6 +40,7 @@ SCR  = .\scr\\
 TEST = .\tst\\
 
 APP  = $(APP:\\=\)
+BENCH = $(BENCH:\\=\)
 CI   = $(CI:\\=\)
 CFGS = $(CFGS:\\=\)
 DOC  = $(DOC:\\=\)